@@ -1,10 +1,68 @@
 #pragma once
 #include <filesystem>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
 
 namespace ice {
 namespace application {
 
-std::filesystem::path path();
+struct numa_node {
+  unsigned id = 0;
+  std::vector<unsigned> cpus;
+};
+
+// Process information that is gathered once on first use.
+// The affinity is captured when the library is initialized, before main(), so that threads
+// pinned with pin_to_cpus() do not reduce it. Changes by sched_setaffinity() calls in static
+// initializers of other libraries or from outside the process are not reflected.
+struct process_info {
+  std::filesystem::path path;       // executable
+  std::filesystem::path directory;  // directory of the executable
+  std::uint64_t pid = 0;            // updated in the child after fork()
+  std::string hostname;
+  unsigned cpu_count = 1;           // online processors of the host
+  std::size_t page_size = 4096;
+  double cpu_limit = 0.0;           // cgroup CPU quota in processors or 0 if unlimited
+  std::uint64_t memory_limit = 0;   // cgroup memory limit in bytes or 0 if unlimited
+  std::vector<unsigned> affinity;   // processors the process was started on
+  std::vector<numa_node> numa_nodes;
+  std::size_t l2_cache_size = 0;    // per processor in bytes or 0 if unknown
+  std::size_t l3_cache_size = 0;
+  unsigned concurrency = 1;         // affinity size limited by the CPU quota
+};
+
+// Returns the process information. Thread-safe.
+const process_info& info();
+
+// Returns the executable path.
+inline const std::filesystem::path& path()
+{
+  return info().path;
+}
+
+// Returns the directory of the executable.
+inline const std::filesystem::path& directory()
+{
+  return info().directory;
+}
+
+// Returns the number of threads that can run in parallel. Use instead of
+// std::thread::hardware_concurrency() to size thread pools in containers.
+inline unsigned concurrency()
+{
+  return info().concurrency;
+}
+
+// Restricts the calling thread to the processors. Throws ice::system_error on failure.
+void pin_to_cpus(const std::vector<unsigned>& cpus);
+
+// Restricts the calling thread to the processor.
+void pin_to_cpu(unsigned cpu);
+
+// Restricts the calling thread to the processors of the NUMA node.
+void pin_to_node(unsigned node);
 
 }  // namespace application
 }  // namespace ice
@@ -53,102 +53,376 @@
 // IF IBM IS APPRISED OF THE POSSIBILITY OF SUCH DAMAGES.
 
 #pragma once
-#include <algorithm>
+#include <ice/bitmask.hpp>
+#include <array>
 #include <string>
 #include <string_view>
-#include <cctype>
+#include <cstddef>
 #include <cstdint>
 
 namespace ice {
 namespace base {
 
 constexpr const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr const char table_url[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
 constexpr const char padding = '=';
 
-inline std::string encode(std::string_view data)
+enum class mode : unsigned {
+  standard = 0x00,  // standard alphabet, whitespace is skipped, padding is optional
+  url = 0x01,       // URL and filename safe alphabet (RFC 4648, Section 5)
+  strict = 0x02,    // whitespace is rejected
+  padded = 0x04,    // padding is written when encoding and required when decoding
+};
+
+}  // namespace base
+}  // namespace ice
+
+template <>
+struct enable_bitmask_operators<ice::base::mode>
 {
-  auto src = data.data();
-  auto size = data.size();
-  std::string dst;
-  dst.resize(4 * (size / 3) + (size % 3 != 0 ? 4 : 0));
-  std::size_t pos = 0;
-  std::uint8_t o[3];
-  while (2 < size) {
-    o[0] = static_cast<std::uint8_t>(*src++);
-    o[1] = static_cast<std::uint8_t>(*src++);
-    o[2] = static_cast<std::uint8_t>(*src++);
-    size -= 3;
-    dst[pos++] = table[o[0] >> 2];
-    dst[pos++] = table[((o[0] & 0x03) << 4) + (o[1] >> 4)];
-    dst[pos++] = table[((o[1] & 0x0f) << 2) + (o[2] >> 6)];
-    dst[pos++] = table[o[2] & 0x3f];
+  static const bool value = true;
+};
+
+namespace ice {
+namespace base {
+
+// Returns the number of characters needed to encode size bytes (including padding).
+constexpr std::size_t encoded_size(std::size_t size) noexcept
+{
+  return (size + 2) / 3 * 4;
+}
+
+// Returns the maximum number of bytes that size characters can be decoded to.
+constexpr std::size_t decoded_size(std::size_t size) noexcept
+{
+  return (size + 3) / 4 * 3;
+}
+
+// Result of a decode operation.
+struct decode_result
+{
+  // Number of bytes written.
+  std::size_t size = 0;
+
+  // Position of the first invalid character or std::string_view::npos.
+  std::size_t error = std::string_view::npos;
+
+  explicit operator bool() const noexcept
+  {
+    return error == std::string_view::npos;
+  }
+};
+
+namespace detail {
+
+constexpr std::uint8_t invalid = 0xFF;
+constexpr std::uint8_t space = 0xFE;
+constexpr std::uint8_t pad = 0xFD;
+
+constexpr std::array<std::uint8_t, 256> make_table(const char* alphabet) noexcept
+{
+  std::array<std::uint8_t, 256> values = {};
+  for (auto& value : values) {
+    value = invalid;
   }
-  if (size != 0) {
-    o[0] = size > 0 ? static_cast<std::uint8_t>(*src++) : 0;
-    o[1] = size > 1 ? static_cast<std::uint8_t>(*src++) : 0;
-    o[2] = size > 2 ? static_cast<std::uint8_t>(*src++) : 0;
-    dst[pos++] = table[o[0] >> 2];
-    dst[pos++] = table[((o[0] & 0x03) << 4) + (o[1] >> 4)];
-    dst[pos++] = size == 1 ? padding : table[((o[1] & 0x0f) << 2) + (o[2] >> 6)];
-    dst[pos++] = padding;
+  for (std::size_t i = 0; i < 64; i++) {
+    values[static_cast<unsigned char>(alphabet[i])] = static_cast<std::uint8_t>(i);
   }
-  return dst;
+  for (const auto c : { ' ', '\t', '\n', '\v', '\f', '\r' }) {
+    values[static_cast<unsigned char>(c)] = space;
+  }
+  values[static_cast<unsigned char>(padding)] = pad;
+  return values;
 }
 
-inline std::string encode(std::basic_string_view<unsigned char> data)
+inline constexpr std::array<std::uint8_t, 256> values = make_table(table);
+inline constexpr std::array<std::uint8_t, 256> values_url = make_table(table_url);
+
+inline char* encode(const char* alphabet, const std::uint8_t* src, char* dst) noexcept
 {
-  return encode(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+  dst[0] = alphabet[src[0] >> 2];
+  dst[1] = alphabet[((src[0] & 0x03) << 4) | (src[1] >> 4)];
+  dst[2] = alphabet[((src[1] & 0x0f) << 2) | (src[2] >> 6)];
+  dst[3] = alphabet[src[2] & 0x3f];
+  return dst + 4;
 }
 
-inline std::string decode(std::string_view data)
+inline char* decode(
+  std::uint8_t a, std::uint8_t b, std::uint8_t c, std::uint8_t d, char* dst) noexcept
 {
-  constexpr auto begin = std::begin(table);
-  constexpr auto end = std::end(table);
-  std::string dst;
-  dst.reserve(data.size() / 4 * 3);
-  auto state = 0;
-  for (const auto c : data) {
-    if (std::isspace(c)) {
-      continue;  // skip spaces
+  dst[0] = static_cast<char>((a << 2) | (b >> 4));
+  dst[1] = static_cast<char>(((b & 0x0f) << 4) | (c >> 2));
+  dst[2] = static_cast<char>(((c & 0x03) << 6) | d);
+  return dst + 3;
+}
+
+}  // namespace detail
+
+// Incremental encoder that carries incomplete blocks across update calls.
+class encoder
+{
+public:
+  explicit encoder(mode mode = mode::padded) noexcept
+    : alphabet_(ice::bitmask(mode & mode::url) ? table_url : table),
+      padded_(ice::bitmask(mode & mode::padded))
+  {}
+
+  // Encodes data into dst, which must hold at least encoded_size(data.size()) characters.
+  // Returns the number of characters written.
+  std::size_t update(std::string_view data, char* dst) noexcept
+  {
+    auto src = reinterpret_cast<const std::uint8_t*>(data.data());
+    auto size = data.size();
+    auto pos = dst;
+    if (size_ != 0) {
+      while (size_ < 3 && size != 0) {
+        buffer_[size_++] = *src++;
+        size--;
+      }
+      if (size_ < 3) {
+        return 0;
+      }
+      pos = detail::encode(alphabet_, buffer_, pos);
+      size_ = 0;
+    }
+    for (; size > 2; size -= 3, src += 3) {
+      pos = detail::encode(alphabet_, src, pos);
+    }
+    while (size != 0) {
+      buffer_[size_++] = *src++;
+      size--;
+    }
+    return static_cast<std::size_t>(pos - dst);
+  }
+
+  // Writes the remaining characters and padding to dst, which must hold at least 4 characters.
+  // Returns the number of characters written and resets the encoder.
+  std::size_t finish(char* dst) noexcept
+  {
+    if (size_ == 0) {
+      return 0;
     }
-    if (c == padding) {
-      if (state > 1) {
-        dst.resize(dst.size() - 1);
+    const auto size = size_;
+    while (size_ < 3) {
+      buffer_[size_++] = 0;
+    }
+    size_ = 0;
+    detail::encode(alphabet_, buffer_, dst);
+    if (!padded_) {
+      return size + 1;
+    }
+    if (size == 1) {
+      dst[2] = padding;
+    }
+    dst[3] = padding;
+    return 4;
+  }
+
+private:
+  const char* alphabet_ = table;
+  std::uint8_t buffer_[3] = {};
+  std::size_t size_ = 0;
+  bool padded_ = true;
+};
+
+// Incremental decoder that carries incomplete blocks across update calls.
+class decoder
+{
+public:
+  explicit decoder(mode mode = mode::standard) noexcept
+    : values_(ice::bitmask(mode & mode::url) ? detail::values_url.data() : detail::values.data()),
+      strict_(ice::bitmask(mode & mode::strict)), padded_(ice::bitmask(mode & mode::padded))
+  {}
+
+  // Decodes data into dst, which must hold at least decoded_size(data.size()) bytes.
+  // Returns the number of bytes written.
+  std::size_t update(std::string_view data, char* dst) noexcept
+  {
+    if (state_ == state::error) {
+      return 0;
+    }
+    const auto begin = reinterpret_cast<const std::uint8_t*>(data.data());
+    const auto end = begin + data.size();
+    auto src = begin;
+    auto pos = dst;
+    while (src != end) {
+      if (state_ == state::decode && size_ == 0) {
+        while (end - src > 3) {
+          const auto a = values_[src[0]];
+          const auto b = values_[src[1]];
+          const auto c = values_[src[2]];
+          const auto d = values_[src[3]];
+          if ((a | b | c | d) & 0xC0) {
+            break;
+          }
+          pos = detail::decode(a, b, c, d, pos);
+          src += 4;
+        }
+        if (src == end) {
+          break;
+        }
+      }
+      const auto value = values_[*src];
+      if (value == detail::space && !strict_) {
+        src++;
+        continue;
+      }
+      if (state_ == state::padding) {
+        if (value != detail::pad || padding_ == 0) {
+          return fail(src - begin, pos - dst);
+        }
+        padding_--;
+        src++;
+        continue;
+      }
+      if (value < 64) {
+        buffer_[size_++] = value;
+        if (size_ == 4) {
+          pos = detail::decode(buffer_[0], buffer_[1], buffer_[2], buffer_[3], pos);
+          size_ = 0;
+        }
+        src++;
+        continue;
+      }
+      if (value != detail::pad || size_ < 2) {
+        return fail(src - begin, pos - dst);
+      }
+      pos += flush(pos);
+      padding_ = size_ == 2 ? 1 : 0;
+      size_ = 0;
+      state_ = state::padding;
+      src++;
+    }
+    position_ += data.size();
+    return static_cast<std::size_t>(pos - dst);
+  }
+
+  // Writes the remaining bytes to dst, which must hold at least 2 bytes.
+  // Returns the number of bytes written.
+  std::size_t finish(char* dst) noexcept
+  {
+    if (state_ == state::error) {
+      return 0;
+    }
+    if (state_ == state::padding) {
+      if (padding_ != 0) {
+        return fail(0, 0);
       }
-      break;  // ignore padding
+      return 0;
     }
-    const auto it = std::find(begin, end, c);
-    if (it == end) {
-      return {};
+    if (size_ == 1 || (size_ != 0 && padded_)) {
+      return fail(0, 0);
     }
-    const auto value = static_cast<std::uint8_t>(it - begin);
-    switch (state) {
-    case 0:
-      dst.push_back(value << 2);
-      state = 1;
-      break;
-    case 1:
-      dst.back() |= value >> 4;
-      dst.push_back((value & 0x0f) << 4);
-      state = 2;
-      break;
+    const auto size = flush(dst);
+    size_ = 0;
+    return size;
+  }
+
+  // Returns true when invalid input was encountered.
+  bool failed() const noexcept
+  {
+    return state_ == state::error;
+  }
+
+  // Returns the position of the first invalid character when failed or the number of processed
+  // characters otherwise.
+  std::size_t position() const noexcept
+  {
+    return position_;
+  }
+
+  // Prepares the decoder for a new input.
+  void reset() noexcept
+  {
+    state_ = state::decode;
+    position_ = 0;
+    padding_ = 0;
+    size_ = 0;
+  }
+
+private:
+  enum class state { decode, padding, error };
+
+  std::size_t fail(std::ptrdiff_t offset, std::ptrdiff_t size) noexcept
+  {
+    state_ = state::error;
+    position_ += static_cast<std::size_t>(offset);
+    return static_cast<std::size_t>(size);
+  }
+
+  std::size_t flush(char* dst) noexcept
+  {
+    switch (size_) {
     case 2:
-      dst.back() |= value >> 2;
-      dst.push_back((value & 0x03) << 6);
-      state = 3;
-      break;
+      dst[0] = static_cast<char>((buffer_[0] << 2) | (buffer_[1] >> 4));
+      return 1;
     case 3:
-      dst.back() |= value;
-      state = 0;
-      break;
+      dst[0] = static_cast<char>((buffer_[0] << 2) | (buffer_[1] >> 4));
+      dst[1] = static_cast<char>(((buffer_[1] & 0x0f) << 4) | (buffer_[2] >> 2));
+      return 2;
     }
+    return 0;
   }
+
+  const std::uint8_t* values_ = detail::values.data();
+  std::uint8_t buffer_[4] = {};
+  std::size_t size_ = 0;
+  std::size_t padding_ = 0;
+  std::size_t position_ = 0;
+  state state_ = state::decode;
+  bool strict_ = false;
+  bool padded_ = false;
+};
+
+// Encodes data into dst, which must hold at least encoded_size(data.size()) characters.
+// Returns the number of characters written.
+inline std::size_t encode(std::string_view data, char* dst, mode mode = mode::padded) noexcept
+{
+  encoder encoder(mode);
+  const auto size = encoder.update(data, dst);
+  return size + encoder.finish(dst + size);
+}
+
+inline std::string encode(std::string_view data, mode mode = mode::padded)
+{
+  std::string dst;
+  dst.resize(encoded_size(data.size()));
+  dst.resize(encode(data, dst.data(), mode));
+  return dst;
+}
+
+inline std::string encode(std::basic_string_view<unsigned char> data, mode mode = mode::padded)
+{
+  return encode(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()), mode);
+}
+
+// Decodes data into dst, which must hold at least decoded_size(data.size()) bytes.
+inline decode_result decode(std::string_view data, char* dst, mode mode = mode::standard) noexcept
+{
+  decoder decoder(mode);
+  decode_result result;
+  result.size = decoder.update(data, dst);
+  result.size += decoder.finish(dst + result.size);
+  if (decoder.failed()) {
+    result.error = decoder.position();
+  }
+  return result;
+}
+
+// Decodes data or returns an empty string when the data is invalid.
+inline std::string decode(std::string_view data, mode mode = mode::standard)
+{
+  std::string dst;
+  dst.resize(decoded_size(data.size()));
+  const auto result = decode(data, dst.data(), mode);
+  dst.resize(result ? result.size : 0);
   return dst;
 }
 
-inline std::string decode(std::basic_string_view<unsigned char> data)
+inline std::string decode(std::basic_string_view<unsigned char> data, mode mode = mode::standard)
 {
-  return decode(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+  return decode(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()), mode);
 }
 
 }  // namespace base
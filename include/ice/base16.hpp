@@ -0,0 +1,183 @@
+#pragma once
+#include <ice/base.hpp>
+#include <ice/simd.hpp>
+#include <array>
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace ice {
+namespace base16 {
+
+constexpr const char table[] = "0123456789abcdef";
+
+using decode_result = ice::base::decode_result;
+
+// Returns the number of characters needed to encode size bytes.
+constexpr std::size_t encoded_size(std::size_t size) noexcept
+{
+  return size * 2;
+}
+
+// Returns the maximum number of bytes that size characters can be decoded to.
+constexpr std::size_t decoded_size(std::size_t size) noexcept
+{
+  return size / 2;
+}
+
+namespace detail {
+
+constexpr std::uint8_t invalid = 0xFF;
+
+constexpr std::array<std::uint8_t, 256> make_table() noexcept
+{
+  std::array<std::uint8_t, 256> values = {};
+  for (auto& value : values) {
+    value = invalid;
+  }
+  for (std::uint8_t i = 0; i < 10; i++) {
+    values['0' + i] = i;
+  }
+  for (std::uint8_t i = 0; i < 6; i++) {
+    values['a' + i] = 10 + i;
+    values['A' + i] = 10 + i;
+  }
+  return values;
+}
+
+inline constexpr std::array<std::uint8_t, 256> values = make_table();
+
+#ifdef ICE_SSE2
+
+// Converts 16 nibbles to lowercase hex digits.
+inline __m128i encode(__m128i nibbles) noexcept
+{
+  const auto letters = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+  const auto offset = _mm_and_si128(letters, _mm_set1_epi8('a' - '0' - 10));
+  return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), offset);
+}
+
+// Converts 16 hex digits to nibbles and sets valid to false if any of them is invalid.
+inline __m128i decode(__m128i digits, bool& valid) noexcept
+{
+  const auto d = _mm_sub_epi8(digits, _mm_set1_epi8('0'));
+  const auto l = _mm_sub_epi8(_mm_or_si128(digits, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  const auto dm = _mm_and_si128(
+    _mm_cmpgt_epi8(digits, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(digits, _mm_set1_epi8('9' + 1)));
+  const auto lm = _mm_and_si128(
+    _mm_cmpgt_epi8(l, _mm_set1_epi8(-1)), _mm_cmplt_epi8(l, _mm_set1_epi8(6)));
+  valid = _mm_movemask_epi8(_mm_or_si128(dm, lm)) == 0xFFFF;
+  const auto lv = _mm_add_epi8(l, _mm_set1_epi8(10));
+  return _mm_or_si128(_mm_and_si128(dm, d), _mm_and_si128(lm, lv));
+}
+
+#endif
+
+}  // namespace detail
+
+// Encodes data into dst, which must hold at least encoded_size(data.size()) characters.
+// Returns the number of characters written.
+inline std::size_t encode(std::string_view data, char* dst) noexcept
+{
+  auto src = reinterpret_cast<const std::uint8_t*>(data.data());
+  auto size = data.size();
+  auto pos = dst;
+#ifdef ICE_SSE2
+  const auto mask = _mm_set1_epi8(0x0F);
+  for (; size > 15; size -= 16, src += 16, pos += 32) {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const auto hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    const auto lo = _mm_and_si128(v, mask);
+    const auto a = detail::encode(_mm_unpacklo_epi8(hi, lo));
+    const auto b = detail::encode(_mm_unpackhi_epi8(hi, lo));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pos), a);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pos + 16), b);
+  }
+#endif
+  for (; size != 0; size--, src++) {
+    *pos++ = table[*src >> 4];
+    *pos++ = table[*src & 0x0F];
+  }
+  return static_cast<std::size_t>(pos - dst);
+}
+
+inline std::string encode(std::string_view data)
+{
+  std::string dst;
+  dst.resize(encoded_size(data.size()));
+  encode(data, dst.data());
+  return dst;
+}
+
+inline std::string encode(std::basic_string_view<unsigned char> data)
+{
+  return encode(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+}
+
+// Decodes data into dst, which must hold at least decoded_size(data.size()) bytes.
+// Both lowercase and uppercase digits are accepted.
+inline decode_result decode(std::string_view data, char* dst) noexcept
+{
+  const auto begin = reinterpret_cast<const std::uint8_t*>(data.data());
+  const auto end = begin + data.size();
+  auto src = begin;
+  auto pos = dst;
+#ifdef ICE_SSE2
+  const auto mask = _mm_set1_epi16(0x00FF);
+  while (end - src > 31) {
+    auto valid = true;
+    auto valid_next = true;
+    const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+    const auto na = detail::decode(a, valid);
+    const auto nb = detail::decode(b, valid_next);
+    if (!valid || !valid_next) {
+      break;
+    }
+    const auto ba = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(na, mask), 4), _mm_srli_epi16(na, 8));
+    const auto bb = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(nb, mask), 4), _mm_srli_epi16(nb, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pos), _mm_packus_epi16(ba, bb));
+    src += 32;
+    pos += 16;
+  }
+#endif
+  decode_result result;
+  for (; src != end; src += 2) {
+    const auto hi = detail::values[src[0]];
+    if (hi == detail::invalid) {
+      result.error = static_cast<std::size_t>(src - begin);
+      break;
+    }
+    if (src + 1 == end) {
+      result.error = data.size();
+      break;
+    }
+    const auto lo = detail::values[src[1]];
+    if (lo == detail::invalid) {
+      result.error = static_cast<std::size_t>(src - begin) + 1;
+      break;
+    }
+    *pos++ = static_cast<char>((hi << 4) | lo);
+  }
+  result.size = static_cast<std::size_t>(pos - dst);
+  return result;
+}
+
+// Decodes data or returns an empty string when the data is invalid.
+inline std::string decode(std::string_view data)
+{
+  std::string dst;
+  dst.resize(decoded_size(data.size()));
+  const auto result = decode(data, dst.data());
+  dst.resize(result ? result.size : 0);
+  return dst;
+}
+
+inline std::string decode(std::basic_string_view<unsigned char> data)
+{
+  return decode(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+}
+
+}  // namespace base16
+}  // namespace ice
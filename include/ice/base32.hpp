@@ -0,0 +1,188 @@
+#pragma once
+#include <ice/base.hpp>
+#include <array>
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace ice {
+namespace base32 {
+
+constexpr const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+constexpr const char padding = '=';
+
+using decode_result = ice::base::decode_result;
+
+// Returns the number of characters needed to encode size bytes (including padding).
+constexpr std::size_t encoded_size(std::size_t size) noexcept
+{
+  return (size + 4) / 5 * 8;
+}
+
+// Returns the maximum number of bytes that size characters can be decoded to.
+constexpr std::size_t decoded_size(std::size_t size) noexcept
+{
+  return (size + 7) / 8 * 5;
+}
+
+namespace detail {
+
+constexpr std::uint8_t invalid = 0xFF;
+constexpr std::uint8_t pad = 0xFD;
+
+constexpr std::array<std::uint8_t, 256> make_table() noexcept
+{
+  std::array<std::uint8_t, 256> values = {};
+  for (auto& value : values) {
+    value = invalid;
+  }
+  for (std::uint8_t i = 0; i < 32; i++) {
+    const auto c = static_cast<unsigned char>(table[i]);
+    values[c] = i;
+    if (c >= 'A' && c <= 'Z') {
+      values[c + 'a' - 'A'] = i;
+    }
+  }
+  values[static_cast<unsigned char>(padding)] = pad;
+  return values;
+}
+
+inline constexpr std::array<std::uint8_t, 256> values = make_table();
+
+// Number of characters that encode the given number of trailing bytes.
+constexpr std::size_t characters[] = { 0, 2, 4, 5, 7 };
+
+inline void encode(std::uint64_t block, char* dst) noexcept
+{
+  for (auto i = 0; i < 8; i++) {
+    dst[i] = table[(block >> (35 - i * 5)) & 0x1F];
+  }
+}
+
+}  // namespace detail
+
+// Encodes data into dst, which must hold at least encoded_size(data.size()) characters.
+// Returns the number of characters written.
+inline std::size_t encode(std::string_view data, char* dst, bool padding = true) noexcept
+{
+  auto src = reinterpret_cast<const std::uint8_t*>(data.data());
+  auto size = data.size();
+  auto pos = dst;
+  for (; size > 4; size -= 5, src += 5, pos += 8) {
+    const auto block = std::uint64_t(src[0]) << 32 | std::uint64_t(src[1]) << 24 |
+      std::uint64_t(src[2]) << 16 | std::uint64_t(src[3]) << 8 | std::uint64_t(src[4]);
+    detail::encode(block, pos);
+  }
+  if (size != 0) {
+    std::uint64_t block = 0;
+    for (std::size_t i = 0; i < size; i++) {
+      block |= std::uint64_t(src[i]) << (32 - i * 8);
+    }
+    char buffer[8];
+    detail::encode(block, buffer);
+    const auto count = detail::characters[size];
+    for (std::size_t i = 0; i < 8; i++) {
+      if (i < count) {
+        *pos++ = buffer[i];
+      } else if (padding) {
+        *pos++ = ice::base32::padding;
+      }
+    }
+  }
+  return static_cast<std::size_t>(pos - dst);
+}
+
+inline std::string encode(std::string_view data, bool padding = true)
+{
+  std::string dst;
+  dst.resize(encoded_size(data.size()));
+  dst.resize(encode(data, dst.data(), padding));
+  return dst;
+}
+
+inline std::string encode(std::basic_string_view<unsigned char> data, bool padding = true)
+{
+  return encode(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()), padding);
+}
+
+// Decodes data into dst, which must hold at least decoded_size(data.size()) bytes.
+// Both lowercase and uppercase characters are accepted and padding is optional.
+inline decode_result decode(std::string_view data, char* dst) noexcept
+{
+  const auto begin = reinterpret_cast<const std::uint8_t*>(data.data());
+  const auto end = begin + data.size();
+  auto src = begin;
+  auto pos = dst;
+  decode_result result;
+  while (end - src > 7) {
+    std::uint64_t block = 0;
+    std::uint8_t check = 0;
+    for (auto i = 0; i < 8; i++) {
+      const auto value = detail::values[src[i]];
+      block = block << 5 | (value & 0x1F);
+      check |= value;
+    }
+    if (check & 0xE0) {
+      break;
+    }
+    for (auto i = 0; i < 5; i++) {
+      *pos++ = static_cast<char>(block >> (32 - i * 8));
+    }
+    src += 8;
+  }
+  std::uint64_t block = 0;
+  std::size_t count = 0;
+  for (; src != end && count < 8; src++, count++) {
+    const auto value = detail::values[*src];
+    if (value == detail::pad) {
+      break;
+    }
+    if (value == detail::invalid) {
+      result.error = static_cast<std::size_t>(src - begin);
+      result.size = static_cast<std::size_t>(pos - dst);
+      return result;
+    }
+    block |= std::uint64_t(value) << (35 - count * 5);
+  }
+  std::size_t bytes = 0;
+  while (bytes < 5 && detail::characters[bytes] < count) {
+    bytes++;
+  }
+  if (count != 0 && (count == 8 || detail::characters[bytes] != count)) {
+    result.error = static_cast<std::size_t>(src - begin);
+  } else if (src != end) {
+    const auto padding = count == 0 ? 0 : 8 - count;
+    for (std::size_t i = 0; i < padding && src != end && *src == ice::base32::padding; i++) {
+      src++;
+    }
+    if (src != end || (count != 0 && static_cast<std::size_t>(end - begin) % 8 != 0)) {
+      result.error = static_cast<std::size_t>(src - begin);
+    }
+  }
+  if (result) {
+    for (std::size_t i = 0; i < bytes; i++) {
+      *pos++ = static_cast<char>(block >> (32 - i * 8));
+    }
+  }
+  result.size = static_cast<std::size_t>(pos - dst);
+  return result;
+}
+
+// Decodes data or returns an empty string when the data is invalid.
+inline std::string decode(std::string_view data)
+{
+  std::string dst;
+  dst.resize(decoded_size(data.size()));
+  const auto result = decode(data, dst.data());
+  dst.resize(result ? result.size : 0);
+  return dst;
+}
+
+inline std::string decode(std::basic_string_view<unsigned char> data)
+{
+  return decode(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+}
+
+}  // namespace base32
+}  // namespace ice
@@ -0,0 +1,563 @@
+#pragma once
+#include <ice/json.hpp>
+#include <filesystem>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace ice {
+namespace config {
+
+// Binds a JSON key to a struct member.
+template <typename T, typename M>
+struct field {
+  std::string_view key;
+  M T::*member;
+};
+
+template <typename T, typename M>
+field(std::string_view, M T::*) -> field<T, M>;
+
+// Specialize with a `static constexpr std::tuple fields` of config::field values to make a
+// struct bindable. Keys that are not listed are skipped and missing keys keep their values.
+//
+//   template <>
+//   struct ice::config::schema<server> {
+//     static constexpr std::tuple fields{
+//       ice::config::field{ "host", &server::host },
+//       ice::config::field{ "port", &server::port },
+//     };
+//   };
+//
+template <typename T>
+struct schema;
+
+// Specialize to bind other types. A binder has a `name` used in error messages and static
+// functions for the JSON values it accepts, each taking a T& as the first argument:
+//
+//   null(T&)                               optional values
+//   boolean(T&, bool)
+//   integer(T&, std::int64_t)
+//   unsigned_integer(T&, std::uint64_t)
+//   number(T&, double)
+//   string(T&, std::string&)
+//   clear(T&)                              called when an object or array starts
+//   field(T&, std::string_view) -> slot    objects, returns an empty slot to skip a key
+//   element(T&) -> slot                    arrays
+//   value(T&) -> slot                      forwards non-null values to another slot
+//
+// Functions may throw std::domain_error to reject a value.
+template <typename T, typename Enable = void>
+struct binder;
+
+struct slot;
+
+namespace detail {
+
+struct binder_ops {
+  std::string_view name;
+  void (*null)(void*);
+  void (*boolean)(void*, bool);
+  void (*integer)(void*, std::int64_t);
+  void (*unsigned_integer)(void*, std::uint64_t);
+  void (*number)(void*, double);
+  void (*string)(void*, std::string&);
+  void (*clear)(void*);
+  slot (*field)(void*, std::string_view);
+  slot (*element)(void*);
+  slot (*value)(void*);
+};
+
+template <typename T>
+constexpr binder_ops make_binder_ops() noexcept;
+
+template <typename T>
+inline constexpr binder_ops binder_ops_v = make_binder_ops<T>();
+
+}  // namespace detail
+
+// Type-erased reference to a value that is being bound.
+struct slot {
+  slot() noexcept = default;
+
+  template <typename T>
+    requires(!std::is_same_v<std::remove_const_t<T>, slot>)
+  slot(T& value) noexcept : ops(&detail::binder_ops_v<T>), target(&value)
+  {}
+
+  explicit operator bool() const noexcept
+  {
+    return ops != nullptr;
+  }
+
+  const detail::binder_ops* ops = nullptr;
+  void* target = nullptr;
+};
+
+namespace detail {
+
+template <typename T>
+constexpr binder_ops make_binder_ops() noexcept
+{
+  using B = binder<T>;
+  binder_ops ops = {};
+  ops.name = B::name;
+  if constexpr (requires(T& v) { B::null(v); }) {
+    ops.null = [](void* p) { B::null(*static_cast<T*>(p)); };
+  }
+  if constexpr (requires(T& v) { B::boolean(v, true); }) {
+    ops.boolean = [](void* p, bool v) { B::boolean(*static_cast<T*>(p), v); };
+  }
+  if constexpr (requires(T& v) { B::integer(v, std::int64_t{}); }) {
+    ops.integer = [](void* p, std::int64_t v) { B::integer(*static_cast<T*>(p), v); };
+  }
+  if constexpr (requires(T& v) { B::unsigned_integer(v, std::uint64_t{}); }) {
+    ops.unsigned_integer = [](void* p, std::uint64_t v) {
+      B::unsigned_integer(*static_cast<T*>(p), v);
+    };
+  }
+  if constexpr (requires(T& v) { B::number(v, double{}); }) {
+    ops.number = [](void* p, double v) { B::number(*static_cast<T*>(p), v); };
+  }
+  if constexpr (requires(T& v, std::string& s) { B::string(v, s); }) {
+    ops.string = [](void* p, std::string& v) { B::string(*static_cast<T*>(p), v); };
+  }
+  if constexpr (requires(T& v) { B::clear(v); }) {
+    ops.clear = [](void* p) { B::clear(*static_cast<T*>(p)); };
+  }
+  if constexpr (requires(T& v) { B::field(v, std::string_view{}); }) {
+    ops.field = [](void* p, std::string_view key) -> slot {
+      return B::field(*static_cast<T*>(p), key);
+    };
+  }
+  if constexpr (requires(T& v) { B::element(v); }) {
+    ops.element = [](void* p) -> slot { return B::element(*static_cast<T*>(p)); };
+  }
+  if constexpr (requires(T& v) { B::value(v); }) {
+    ops.value = [](void* p) -> slot { return B::value(*static_cast<T*>(p)); };
+  }
+  return ops;
+}
+
+}  // namespace detail
+
+template <>
+struct binder<bool> {
+  static constexpr std::string_view name = "boolean";
+
+  static void boolean(bool& value, bool v) noexcept
+  {
+    value = v;
+  }
+};
+
+template <typename T>
+struct binder<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>> {
+  static constexpr std::string_view name = std::is_signed_v<T> ? "integer" : "unsigned integer";
+
+  static void integer(T& value, std::int64_t v)
+  {
+    if (!std::in_range<T>(v)) {
+      throw std::domain_error("integer out of range");
+    }
+    value = static_cast<T>(v);
+  }
+
+  static void unsigned_integer(T& value, std::uint64_t v)
+  {
+    if (!std::in_range<T>(v)) {
+      throw std::domain_error("integer out of range");
+    }
+    value = static_cast<T>(v);
+  }
+};
+
+template <typename T>
+struct binder<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+  static constexpr std::string_view name = "number";
+
+  static void integer(T& value, std::int64_t v) noexcept
+  {
+    value = static_cast<T>(v);
+  }
+
+  static void unsigned_integer(T& value, std::uint64_t v) noexcept
+  {
+    value = static_cast<T>(v);
+  }
+
+  static void number(T& value, double v) noexcept
+  {
+    value = static_cast<T>(v);
+  }
+};
+
+template <>
+struct binder<std::string> {
+  static constexpr std::string_view name = "string";
+
+  static void string(std::string& value, std::string& v)
+  {
+    value.assign(v);
+  }
+};
+
+template <>
+struct binder<std::filesystem::path> {
+  static constexpr std::string_view name = "string";
+
+  static void string(std::filesystem::path& value, std::string& v)
+  {
+    value.assign(v);
+  }
+};
+
+template <typename T>
+struct binder<std::optional<T>> {
+  static constexpr std::string_view name = binder<T>::name;
+
+  static void null(std::optional<T>& value) noexcept
+  {
+    value.reset();
+  }
+
+  static slot value(std::optional<T>& value)
+  {
+    if (!value) {
+      value.emplace();
+    }
+    return *value;
+  }
+};
+
+template <typename T, typename Allocator>
+struct binder<std::vector<T, Allocator>> {
+  static constexpr std::string_view name = "array";
+
+  static void clear(std::vector<T, Allocator>& value) noexcept
+  {
+    value.clear();
+  }
+
+  static slot element(std::vector<T, Allocator>& value)
+  {
+    return value.emplace_back();
+  }
+};
+
+template <typename T, typename Compare, typename Allocator>
+struct binder<std::map<std::string, T, Compare, Allocator>> {
+  static constexpr std::string_view name = "object";
+
+  static void clear(std::map<std::string, T, Compare, Allocator>& value) noexcept
+  {
+    value.clear();
+  }
+
+  static slot field(std::map<std::string, T, Compare, Allocator>& value, std::string_view key)
+  {
+    return value.try_emplace(std::string(key)).first->second;
+  }
+};
+
+template <typename T, typename Hash, typename Equal, typename Allocator>
+struct binder<std::unordered_map<std::string, T, Hash, Equal, Allocator>> {
+  static constexpr std::string_view name = "object";
+
+  static void clear(std::unordered_map<std::string, T, Hash, Equal, Allocator>& value) noexcept
+  {
+    value.clear();
+  }
+
+  static slot field(
+    std::unordered_map<std::string, T, Hash, Equal, Allocator>& value, std::string_view key)
+  {
+    return value.try_emplace(std::string(key)).first->second;
+  }
+};
+
+template <typename T>
+struct binder<T, std::void_t<decltype(schema<T>::fields)>> {
+  static constexpr std::string_view name = "object";
+
+  static slot field(T& value, std::string_view key) noexcept
+  {
+    return std::apply(
+      [&](const auto&... fields) {
+        slot result;
+        ((fields.key == key ? (result = slot(value.*fields.member), true) : false) || ...);
+        return result;
+      },
+      schema<T>::fields);
+  }
+};
+
+namespace detail {
+
+// Input iterator over a character range that publishes its position to the binder.
+class tracking_iterator
+{
+public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = char;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const char*;
+  using reference = const char&;
+
+  tracking_iterator(const char* it, const char** cursor) noexcept : it_(it), cursor_(cursor) {}
+
+  reference operator*() const noexcept
+  {
+    return *it_;
+  }
+
+  tracking_iterator& operator++() noexcept
+  {
+    *cursor_ = ++it_;
+    return *this;
+  }
+
+  bool operator==(const tracking_iterator& other) const noexcept
+  {
+    return it_ == other.it_;
+  }
+
+  bool operator!=(const tracking_iterator& other) const noexcept
+  {
+    return it_ != other.it_;
+  }
+
+private:
+  const char* it_;
+  const char** cursor_;
+};
+
+// SAX handler that writes parser events to slots instead of building a DOM.
+class binder_handler
+{
+public:
+  explicit binder_handler(slot root) : root_(root)
+  {
+    stack_.reserve(16);
+  }
+
+  bool null()
+  {
+    if (const auto s = next(); s && s.ops->null) {
+      s.ops->null(s.target);
+    }
+    else if (s) {
+      mismatch(s, "null");
+    }
+    return true;
+  }
+
+  bool boolean(bool v)
+  {
+    return value(next(), "boolean", &binder_ops::boolean, v);
+  }
+
+  bool number_integer(json::number_integer_t v)
+  {
+    return value(next(), "integer", &binder_ops::integer, v);
+  }
+
+  bool number_unsigned(json::number_unsigned_t v)
+  {
+    return value(next(), "integer", &binder_ops::unsigned_integer, v);
+  }
+
+  bool number_float(json::number_float_t v, const json::string_t&)
+  {
+    return value(next(), "number", &binder_ops::number, v);
+  }
+
+  bool string(json::string_t& v)
+  {
+    return value(next(), "string", &binder_ops::string, v);
+  }
+
+  bool binary(json::binary_t&)
+  {
+    throw std::domain_error("unexpected binary value");
+  }
+
+  bool start_object(std::size_t)
+  {
+    return open(&binder_ops::field, "object", false);
+  }
+
+  bool key(json::string_t& key)
+  {
+    auto& frame = stack_.back();
+    if (frame.self) {
+      frame.next = frame.self.ops->field(frame.self.target, key);
+    }
+    return true;
+  }
+
+  bool end_object()
+  {
+    stack_.pop_back();
+    return true;
+  }
+
+  bool start_array(std::size_t)
+  {
+    return open(&binder_ops::element, "array", true);
+  }
+
+  bool end_array()
+  {
+    stack_.pop_back();
+    return true;
+  }
+
+  bool parse_error(std::size_t, const std::string&, const json::exception& e)
+  {
+    // Drop the "[json.exception.parse_error.101] parse error at line 1, column 2: " prefix.
+    std::string_view what = e.what();
+    if (const auto pos = what.find(": "); pos != std::string_view::npos) {
+      what.remove_prefix(pos + 2);
+    }
+    throw std::domain_error(std::string(what));
+  }
+
+private:
+  struct frame {
+    slot self;
+    slot next;
+    bool array = false;
+  };
+
+  // Returns the slot for the next value or an empty slot if it is skipped.
+  slot next()
+  {
+    if (stack_.empty()) {
+      return std::exchange(root_, {});
+    }
+    auto& frame = stack_.back();
+    if (!frame.self) {
+      return {};
+    }
+    if (frame.array) {
+      return frame.self.ops->element(frame.self.target);
+    }
+    return std::exchange(frame.next, {});
+  }
+
+  [[noreturn]] static void mismatch(slot s, std::string_view type)
+  {
+    std::string message = "expected ";
+    message.append(s.ops->name).append(", got ").append(type);
+    throw std::domain_error(message);
+  }
+
+  static slot resolve(slot s)
+  {
+    while (s.ops->value) {
+      s = s.ops->value(s.target);
+    }
+    return s;
+  }
+
+  template <typename F, typename... Args>
+  bool value(slot s, std::string_view type, F binder_ops::*function, Args&&... args)
+  {
+    if (!s) {
+      return true;
+    }
+    s = resolve(s);
+    const auto f = s.ops->*function;
+    if (!f) {
+      mismatch(s, type);
+    }
+    f(s.target, std::forward<Args>(args)...);
+    return true;
+  }
+
+  template <typename F>
+  bool open(F binder_ops::*function, std::string_view type, bool array)
+  {
+    auto s = next();
+    if (s) {
+      s = resolve(s);
+      if (!(s.ops->*function)) {
+        mismatch(s, type);
+      }
+      if (s.ops->clear) {
+        s.ops->clear(s.target);
+      }
+    }
+    stack_.push_back({ s, {}, array });
+    return true;
+  }
+
+  slot root_;
+  std::vector<frame> stack_;
+};
+
+// Parses the comment-free range into the value and reports errors with their line and column.
+inline void bind(const char* begin, const char* end, slot value, const std::string& name)
+{
+  const char* cursor = begin;
+  binder_handler handler(value);
+  try {
+    json::sax_parse(tracking_iterator(begin, &cursor), tracking_iterator(end, &cursor), &handler);
+  }
+  catch (const std::domain_error& e) {
+    std::size_t line = 1;
+    const char* line_begin = begin;
+    for (auto it = begin; it != cursor; ++it) {
+      if (*it == '\n') {
+        line++;
+        line_begin = it + 1;
+      }
+    }
+    const auto column = static_cast<std::size_t>(cursor - line_begin);
+    auto message = name.empty() ? std::string() : name + ": ";
+    message += "line " + std::to_string(line) + ", column " + std::to_string(column) + ": ";
+    throw std::domain_error(message + e.what());
+  }
+}
+
+}  // namespace detail
+
+// Decodes the config file directly into the value without building a JSON document.
+// Throws std::domain_error with the file name, line and column when the input is invalid or
+// does not match the value type.
+template <typename T>
+inline void bind(const std::filesystem::path& path, T& value)
+{
+  auto file = detail::open(path);
+  strip(file.data(), file.data() + file.size());
+  detail::bind(file.data(), file.data() + file.size(), value, path.string());
+}
+
+template <typename T>
+inline void bind(std::string s, T& value)
+{
+  strip(s.data(), s.data() + s.size());
+  detail::bind(s.data(), s.data() + s.size(), value, {});
+}
+
+template <typename T>
+inline T bind(const std::filesystem::path& path)
+{
+  T value = {};
+  bind(path, value);
+  return value;
+}
+
+}  // namespace config
+}  // namespace ice
@@ -0,0 +1,306 @@
+#pragma once
+#include <ice/json.hpp>
+#include <ice/log.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+#ifdef __linux__
+#  include <sys/eventfd.h>
+#  include <sys/inotify.h>
+#  include <cerrno>
+#  include <poll.h>
+#  include <unistd.h>
+#endif
+
+namespace ice {
+namespace config {
+
+// Watches a config file and publishes an immutable snapshot after every change.
+//
+// Readers call get() to load the current snapshot. The snapshot is a std::atomic<std::shared_ptr>,
+// which is not lock-free in libstdc++ (it uses a short internal spinlock), but readers never wait
+// for a reload. Subscribers are called on the reloading thread, without holding any watcher lock,
+// with the new snapshot and the JSON patch operations (RFC 6902) that touch their subtree.
+// Changes that fail to parse are logged and the previous snapshot is kept.
+class watcher
+{
+public:
+  using snapshot = std::shared_ptr<const json>;
+  using callback = std::function<void(const snapshot& config, const json& patch)>;
+
+  // Parses the file and starts watching it. Throws if the initial parse fails.
+  explicit watcher(std::filesystem::path path)
+    : path_(std::filesystem::absolute(std::move(path))),
+      snapshot_(std::make_shared<const json>(load(path_)))
+  {
+    start();
+  }
+
+  watcher(watcher&& other) = delete;
+  watcher& operator=(watcher&& other) = delete;
+
+  ~watcher()
+  {
+    stop();
+  }
+
+  // Returns the current snapshot.
+  snapshot get() const noexcept
+  {
+    return snapshot_.load(std::memory_order_acquire);
+  }
+
+  // Calls the callback when anything at or below the JSON pointer changes.
+  // Returns an identifier for unsubscribe.
+  std::size_t subscribe(const json::json_pointer& pointer, callback callback)
+  {
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    const auto id = ++subscribers_id_;
+    subscribers_.push_back({ id, pointer.to_string(), std::move(callback) });
+    return id;
+  }
+
+  void unsubscribe(std::size_t id)
+  {
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    std::erase_if(subscribers_, [id](const subscriber& s) {
+      return s.id == id;
+    });
+  }
+
+  // Parses the file and publishes a new snapshot if it changed.
+  // Returns false if the file could not be parsed.
+  bool reload()
+  {
+    snapshot config;
+    json patch;
+    std::vector<subscriber> subscribers;
+    {
+      std::lock_guard<std::mutex> lock(reload_mutex_);
+      try {
+        config = std::make_shared<const json>(load(path_));
+      }
+      catch (...) {
+        ice::log::warning() << "config reload failed: " << path_.string() << ": "
+                            << std::current_exception();
+        return false;
+      }
+      const auto previous = snapshot_.load(std::memory_order_acquire);
+      patch = json::diff(*previous, *config);
+      if (patch.empty()) {
+        return true;
+      }
+      snapshot_.store(config, std::memory_order_release);
+
+      std::lock_guard<std::mutex> subscribers_lock(subscribers_mutex_);
+      subscribers = subscribers_;
+    }
+
+    // Subscribers may call reload() or take their time without blocking other reloads.
+    for (const auto& subscriber : subscribers) {
+      auto changes = json::array();
+      for (const auto& operation : patch) {
+        if (affects(subscriber.pointer, operation)) {
+          changes.push_back(operation);
+        }
+      }
+      if (!changes.empty()) {
+        subscriber.function(config, changes);
+      }
+    }
+    return true;
+  }
+
+private:
+  struct subscriber
+  {
+    std::size_t id;
+    std::string pointer;
+    watcher::callback function;
+  };
+
+  // Reads the file into memory and parses it. The file is not mapped, because editors may
+  // truncate it while it is parsed, and reading a mapping past the new end raises SIGBUS.
+  static json load(const std::filesystem::path& path)
+  {
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+      throw std::domain_error("could not open file: " + path.string());
+    }
+    std::string data{ std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>() };
+    strip(data.data(), data.data() + data.size());
+    return json::parse(data);
+  }
+
+  // Returns true if the pointer is equal to or a prefix of the other pointer.
+  static bool contains(const std::string& pointer, const std::string& other)
+  {
+    return other.starts_with(pointer) &&
+      (other.size() == pointer.size() || other[pointer.size()] == '/');
+  }
+
+  static bool affects(const std::string& pointer, const json& operation)
+  {
+    for (const auto key : { "path", "from" }) {
+      const auto it = operation.find(key);
+      if (it == operation.end()) {
+        continue;
+      }
+      const auto& path = it->template get_ref<const std::string&>();
+      if (contains(pointer, path) || contains(path, pointer)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+#ifdef __linux__
+
+  void start()
+  {
+    inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    event_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_ < 0 || event_ < 0) {
+      const auto ec = std::error_code(errno, std::system_category());
+      close();
+      throw ice::system_error(ec, "could not create config watcher");
+    }
+
+    // Watch the directory so that files replaced by rename are detected as well.
+    const auto directory = path_.parent_path().string();
+    constexpr auto mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+    if (inotify_add_watch(inotify_, directory.c_str(), mask) < 0) {
+      const auto ec = std::error_code(errno, std::system_category());
+      close();
+      throw ice::system_error(ec, "could not watch config directory") << directory;
+    }
+    thread_ = std::thread([this]() {
+      run();
+    });
+  }
+
+  void stop()
+  {
+    if (thread_.joinable()) {
+      const std::uint64_t value = 1;
+      [[maybe_unused]] const auto rv = ::write(event_, &value, sizeof(value));
+      thread_.join();
+    }
+    close();
+  }
+
+  void close()
+  {
+    if (inotify_ >= 0) {
+      ::close(inotify_);
+      inotify_ = -1;
+    }
+    if (event_ >= 0) {
+      ::close(event_);
+      event_ = -1;
+    }
+  }
+
+  void run()
+  {
+    const auto filename = path_.filename().string();
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = { { inotify_, POLLIN, 0 }, { event_, POLLIN, 0 } };
+    while (true) {
+      if (::poll(fds, 2, -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return;
+      }
+      if (fds[1].revents) {
+        return;
+      }
+      auto changed = false;
+      ssize_t size = 0;
+      while ((size = ::read(inotify_, buffer, sizeof(buffer))) > 0) {
+        for (auto pos = buffer; pos < buffer + size;) {
+          const auto event = reinterpret_cast<const inotify_event*>(pos);
+          if (event->len && filename == event->name) {
+            changed = true;
+          }
+          pos += sizeof(inotify_event) + event->len;
+        }
+      }
+      if (changed) {
+        reload();
+      }
+    }
+  }
+
+  int inotify_ = -1;
+  int event_ = -1;
+
+#else
+
+  void start()
+  {
+    std::error_code ec;
+    time_ = std::filesystem::last_write_time(path_, ec);
+    thread_ = std::thread([this]() {
+      run();
+    });
+  }
+
+  void stop()
+  {
+    if (thread_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stop_ = true;
+      }
+      stop_cv_.notify_one();
+      thread_.join();
+    }
+  }
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    while (!stop_cv_.wait_for(lock, std::chrono::seconds(1), [this]() { return stop_; })) {
+      std::error_code ec;
+      const auto time = std::filesystem::last_write_time(path_, ec);
+      if (!ec && time != time_) {
+        time_ = time;
+        reload();
+      }
+    }
+  }
+
+  std::filesystem::file_time_type time_;
+  std::condition_variable stop_cv_;
+  std::mutex stop_mutex_;
+  bool stop_ = false;
+
+#endif
+
+  const std::filesystem::path path_;
+  std::atomic<snapshot> snapshot_;
+  std::mutex reload_mutex_;
+
+  std::vector<subscriber> subscribers_;
+  std::mutex subscribers_mutex_;
+  std::size_t subscribers_id_ = 0;
+
+  std::thread thread_;
+};
+
+}  // namespace config
+}  // namespace ice
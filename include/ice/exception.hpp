@@ -1,9 +1,16 @@
 #pragma once
+#include <ice/stacktrace.hpp>
+#include <charconv>
 #include <exception>
-#include <sstream>
+#include <ostream>
 #include <stdexcept>
+#include <streambuf>
 #include <string>
+#include <string_view>
 #include <system_error>
+#include <type_traits>
+#include <cstddef>
+#include <cstring>
 
 namespace ice {
 
@@ -12,13 +19,229 @@ class exception
 public:
   virtual const char* what() const noexcept = 0;
   virtual const char* info() const noexcept = 0;
+
+  // Returns the stack at the point of construction or null if it was not captured.
+  virtual const ice::stacktrace* trace() const noexcept
+  {
+    return nullptr;
+  }
 };
 
+namespace detail {
+
+// Null-terminated string that is stored inline until it outgrows the buffer.
+class exception_info
+{
+public:
+  bool empty() const noexcept
+  {
+    return size_ == 0;
+  }
+
+  const char* c_str() const noexcept
+  {
+    return size_ < sizeof(buffer_) ? buffer_ : heap_.c_str();
+  }
+
+  void append(const char* data, std::size_t size)
+  {
+    if (size_ + size < sizeof(buffer_)) {
+      std::memcpy(buffer_ + size_, data, size);
+      size_ += size;
+      buffer_[size_] = '\0';
+      return;
+    }
+    if (size_ < sizeof(buffer_)) {
+      heap_.reserve(size_ + size + sizeof(buffer_));
+      heap_.assign(buffer_, size_);
+    }
+    heap_.append(data, size);
+    size_ += size;
+  }
+
+  void append(std::string_view s)
+  {
+    append(s.data(), s.size());
+  }
+
+  void push_back(char c)
+  {
+    append(&c, 1);
+  }
+
+private:
+  std::size_t size_ = 0;
+  char buffer_[120] = {};
+  std::string heap_;
+};
+
+// Stream buffer that appends to an exception_info.
+class exception_streambuf : public std::streambuf
+{
+public:
+  exception_info* info = nullptr;
+
+protected:
+  int_type overflow(int_type c) override
+  {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      info->push_back(traits_type::to_char_type(c));
+    }
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char* s, std::streamsize n) override
+  {
+    info->append(s, static_cast<std::size_t>(n));
+    return n;
+  }
+};
+
+template <typename V>
+inline constexpr bool is_exception_number_v = std::is_arithmetic_v<V> &&
+  !std::is_same_v<V, bool> && !std::is_same_v<V, char> && !std::is_same_v<V, signed char> &&
+  !std::is_same_v<V, unsigned char> && !std::is_same_v<V, wchar_t> &&
+  !std::is_same_v<V, char8_t> && !std::is_same_v<V, char16_t> && !std::is_same_v<V, char32_t>;
+
+// Formats values into an exception_info with the state of a std::ostream.
+// Strings and numbers with default formatting are appended directly. Other values and
+// manipulators go through a thread-local std::ostream that writes into the same storage.
+class info_stream
+{
+public:
+  using endl = std::ostream& (*)(std::ostream&);
+
+  template <typename V>
+  void write(const V& v)
+  {
+    if constexpr (std::is_convertible_v<const V&, std::string_view>) {
+      if constexpr (std::is_pointer_v<V>) {
+        if (!v) {
+          return format(v);
+        }
+      }
+      if (width_ == 0) {
+        return info_.append(std::string_view(v));
+      }
+    }
+    else if constexpr (std::is_same_v<V, char>) {
+      if (width_ == 0) {
+        return info_.push_back(v);
+      }
+    }
+    else if constexpr (is_exception_number_v<V>) {
+      if (width_ == 0 && precision_ == 6 && flags_ == default_flags) {
+        char buffer[64];
+        std::to_chars_result result;
+        if constexpr (std::is_floating_point_v<V>) {
+          result = std::to_chars(buffer, buffer + sizeof(buffer), v, std::chars_format::general, 6);
+        }
+        else {
+          result = std::to_chars(buffer, buffer + sizeof(buffer), v);
+        }
+        return info_.append(buffer, static_cast<std::size_t>(result.ptr - buffer));
+      }
+    }
+    format(v);
+  }
+
+  void write(const std::error_code& ec)
+  {
+    char value[16];
+    const auto result = std::to_chars(value, value + sizeof(value), ec.value());
+    info_.append(ec.category().name());
+    info_.push_back(' ');
+    info_.append(value, static_cast<std::size_t>(result.ptr - value));
+    info_.append(": ", 2);
+    info_.append(ec.message());
+  }
+
+  void write(endl)
+  {
+    info_.push_back('\n');
+  }
+
+  const char* c_str() const noexcept
+  {
+    return info_.empty() ? nullptr : info_.c_str();
+  }
+
+private:
+  static constexpr auto default_flags = std::ios_base::skipws | std::ios_base::dec;
+
+  // The thread-local stream is shared by all value types. A pristine stream is kept to reset
+  // the state that is not carried between values.
+  struct stream_state
+  {
+    exception_streambuf buffer;
+    std::ostream stream{ &buffer };
+    std::ostream defaults{ nullptr };
+    bool busy = false;
+  };
+
+  static stream_state& state() noexcept
+  {
+    thread_local stream_state state;
+    return state;
+  }
+
+  template <typename V>
+  void format(const V& v)
+  {
+    auto& current = state();
+    if (current.busy) {
+      // A value that throws an exception_stream from its own operator<<.
+      exception_streambuf nested;
+      std::ostream os(&nested);
+      return format(os, nested, v);
+    }
+    struct guard {
+      bool& busy;
+      guard(bool& busy) noexcept : busy(busy)
+      {
+        busy = true;
+      }
+      ~guard()
+      {
+        busy = false;
+      }
+    } guard(current.busy);
+    format(current.stream, current.buffer, v);
+  }
+
+  template <typename V>
+  void format(std::ostream& os, exception_streambuf& buffer, const V& v)
+  {
+    buffer.info = &info_;
+    os.copyfmt(state().defaults);
+    os.clear();
+    os.flags(flags_);
+    os.precision(precision_);
+    os.width(width_);
+    os.fill(fill_);
+    os << v;
+    fill_ = os.fill();
+    width_ = os.width();
+    precision_ = os.precision();
+    flags_ = os.flags();
+  }
+
+  exception_info info_;
+  std::ios_base::fmtflags flags_ = default_flags;
+  std::streamsize precision_ = 6;
+  std::streamsize width_ = 0;
+  char fill_ = ' ';
+};
+
+}  // namespace detail
+
+// Exception with a stream interface for additional information.
+// The stack is captured on construction when ice::stacktrace::enable(true) was called.
 template <typename T>
 class exception_stream : public exception, public T
 {
 public:
-  using endl = std::ostream& (*)(std::ostream&);
+  using endl = detail::info_stream::endl;
 
   using T::T;
 
@@ -31,28 +254,13 @@ public:
   template <typename V>
   exception_stream& operator<<(const V& v)
   {
-    std::ostringstream oss;
-    oss.flags(flags_);
-    oss.precision(precision_);
-    oss.width(width_);
-    oss << v;
-    width_ = oss.width();
-    precision_ = oss.precision();
-    flags_ = oss.flags();
-    info_.append(oss.str());
-    return *this;
-  }
-
-  exception_stream& operator<<(const std::error_code& ec)
-  {
-    info_.append(
-      std::string(ec.category().name()) + ' ' + std::to_string(ec.value()) + ": " + ec.message());
+    info_.write(v);
     return *this;
   }
 
   exception_stream& operator<<(endl)
   {
-    info_.push_back('\n');
+    info_.write(endl{});
     return *this;
   }
 
@@ -63,23 +271,17 @@ public:
 
   const char* info() const noexcept override
   {
-    if (info_.empty()) {
-      return nullptr;
-    }
     return info_.c_str();
   }
 
-private:
-  static std::ios_base::fmtflags default_flags()
+  const ice::stacktrace* trace() const noexcept override
   {
-    static const std::ios_base::fmtflags flags = std::ostringstream().flags();
-    return flags;
+    return trace_.empty() ? nullptr : &trace_;
   }
 
-  std::string info_;
-  std::ios_base::fmtflags flags_ = default_flags();
-  std::streamsize precision_ = 0;
-  std::streamsize width_ = 0;
+private:
+  detail::info_stream info_;
+  ice::stacktrace trace_ = ice::stacktrace::capture();
 };
 
 using runtime_error = exception_stream<std::runtime_error>;
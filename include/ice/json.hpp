@@ -1,8 +1,23 @@
 #pragma once
+#include <ice/mapped_file.hpp>
+#include <ice/sha256.hpp>
+#include <ice/simd.hpp>
+#include <ice/uuid.hpp>
 #include <nlohmann/json.hpp>
+#include <array>
+#include <bit>
 #include <filesystem>
 #include <fstream>
-#include <sstream>
+#include <initializer_list>
+#include <istream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 namespace ice {
 
@@ -10,84 +25,399 @@ using namespace ::nlohmann;
 
 namespace config {
 
-inline json parse(std::istream& is)
+namespace detail {
+
+// Table-driven lexer for JSON with comments. It tracks whether the input is inside a string,
+// an escape sequence or a comment one character at a time and tells the caller what to do with
+// each character. Comments are only recognized outside of strings.
+class jsonc_lexer
 {
-  std::stringstream ss;
-  for (std::string line; std::getline(is, line);) {
-    enum class state { none, escape, escape_u, escape_0, escape_1, escape_2, string, slash, end };
-    auto s = state::none;
-    std::size_t size = 0;
-    for (auto it = line.begin(), end = line.end(); s != state::end && it != end; ++it) {
-      switch (s) {
-      case state::none:
-        switch (*it) {
-        case '"':
-          s = state::string;
-          break;
-        case '/':
-          s = state::slash;
-          break;
-        }
-        break;
-      case state::string:
-        switch (*it) {
-        case '"':
-          s = state::none;
-          break;
-        case '\\':
-          s = state::escape;
-          break;
-        }
-        break;
-      case state::escape:
-        switch (*it) {
-        case 'u':
-          s = state::escape_u;
-          break;
-        default:
-          s = state::string;
-          break;
-        }
-        break;
-      case state::escape_u:
-      case state::escape_0:
-      case state::escape_1:
-      case state::escape_2:
-        if (*it < '0' || *it > '9') {
-          throw std::domain_error("invalid unicode escape sequence");
-        }
-        s = static_cast<state>(static_cast<int>(s) + 1);
-        break;
-      case state::slash:
-        if (*it != '/') {
-          throw std::domain_error("invalid comment syntax");
-        }
-        size--;
-        s = state::end;
+public:
+  enum class state : std::uint8_t {
+    code,
+    string,
+    escape,
+    unicode_0,
+    unicode_1,
+    unicode_2,
+    unicode_3,
+    slash,
+    line,
+    block,
+    block_star,
+  };
+
+  enum class action : std::uint8_t {
+    keep,             // part of the document
+    blank,            // part of a comment
+    space,            // end of a block comment, replaced with a space
+    invalid_comment,  // a slash that does not start a comment
+    invalid_escape,
+    invalid_unicode,
+  };
+
+  state get() const noexcept
+  {
+    return state_;
+  }
+
+  action next(char c) noexcept
+  {
+    const auto& row = transitions[static_cast<std::size_t>(state_)];
+    const auto t = row[classes[static_cast<unsigned char>(c)]];
+    state_ = t.next;
+    return t.output;
+  }
+
+  // Throws if the input ended inside of a comment.
+  void finish() const
+  {
+    switch (state_) {
+    case state::slash:
+      raise(action::invalid_comment);
+    case state::block:
+    case state::block_star:
+      throw std::domain_error("unterminated comment");
+    default:
+      break;
+    }
+  }
+
+  [[noreturn]] static void raise(action output)
+  {
+    switch (output) {
+    case action::invalid_escape:
+      throw std::domain_error("invalid escape sequence");
+    case action::invalid_unicode:
+      throw std::domain_error("invalid unicode escape sequence");
+    default:
+      throw std::domain_error("invalid comment syntax");
+    }
+  }
+
+private:
+  enum character : std::uint8_t {
+    other,
+    quote,
+    backslash,
+    slash,
+    star,
+    newline,
+    hex,         // hex digit that is not an escape character
+    escape,      // escape character that is not a hex digit
+    hex_escape,  // b and f
+    u,
+    characters,
+  };
+
+  struct transition {
+    state next;
+    action output;
+  };
+
+  static constexpr std::size_t states = static_cast<std::size_t>(state::block_star) + 1;
+
+  static constexpr auto classes = [] {
+    std::array<std::uint8_t, 256> classes = {};
+    for (const auto c : std::string_view("0123456789acdeABCDEF")) {
+      classes[static_cast<unsigned char>(c)] = hex;
+    }
+    for (const auto c : std::string_view("nrt")) {
+      classes[static_cast<unsigned char>(c)] = escape;
+    }
+    classes['b'] = hex_escape;
+    classes['f'] = hex_escape;
+    classes['u'] = u;
+    classes['"'] = quote;
+    classes['\\'] = backslash;
+    classes['/'] = slash;
+    classes['*'] = star;
+    classes['\n'] = newline;
+    return classes;
+  }();
+
+  static constexpr auto transitions = [] {
+    std::array<std::array<transition, characters>, states> table = {};
+    const auto set = [&](state from, std::initializer_list<character> cs, state to, action a) {
+      for (const auto c : cs) {
+        table[static_cast<std::size_t>(from)][c] = { to, a };
+      }
+    };
+    const auto all = { other, quote, backslash, slash, star, newline, hex, escape, hex_escape, u };
+    set(state::code, all, state::code, action::keep);
+    set(state::code, { quote }, state::string, action::keep);
+    set(state::code, { slash }, state::slash, action::blank);
+
+    set(state::string, all, state::string, action::keep);
+    set(state::string, { quote }, state::code, action::keep);
+    set(state::string, { backslash }, state::escape, action::keep);
+
+    set(state::escape, all, state::string, action::invalid_escape);
+    const auto escapes = { quote, backslash, slash, escape, hex_escape };
+    set(state::escape, escapes, state::string, action::keep);
+    set(state::escape, { u }, state::unicode_0, action::keep);
+
+    const state unicode[] = {
+      state::unicode_0, state::unicode_1, state::unicode_2, state::unicode_3, state::string,
+    };
+    for (auto i = 0; i < 4; i++) {
+      set(unicode[i], all, state::string, action::invalid_unicode);
+      set(unicode[i], { hex, hex_escape }, unicode[i + 1], action::keep);
+    }
+
+    set(state::slash, all, state::code, action::invalid_comment);
+    set(state::slash, { slash }, state::line, action::blank);
+    set(state::slash, { star }, state::block, action::blank);
+
+    set(state::line, all, state::line, action::blank);
+    set(state::line, { newline }, state::code, action::keep);
+
+    set(state::block, all, state::block, action::blank);
+    set(state::block, { star }, state::block_star, action::blank);
+    set(state::block, { newline }, state::block, action::keep);
+
+    set(state::block_star, all, state::block, action::blank);
+    set(state::block_star, { star }, state::block_star, action::blank);
+    set(state::block_star, { slash }, state::code, action::space);
+    set(state::block_star, { newline }, state::block, action::keep);
+    return table;
+  }();
+
+  state state_ = state::code;
+};
+
+// Returns a pointer to the first occurrence of a or b or end.
+inline char* find(char* it, char* end, char a, char b) noexcept
+{
+#ifdef ICE_SSE2
+  const auto va = _mm_set1_epi8(a);
+  const auto vb = _mm_set1_epi8(b);
+  for (; end - it > 15; it += 16) {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+    const auto m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+    if (m) {
+      return it + std::countr_zero(static_cast<unsigned>(m));
+    }
+  }
+#endif
+  for (; it != end; ++it) {
+    if (*it == a || *it == b) {
+      return it;
+    }
+  }
+  return end;
+}
+
+inline ice::mapped_file open(const std::filesystem::path& path)
+{
+  try {
+    return ice::mapped_file(path);
+  }
+  catch (const std::system_error&) {
+    throw std::domain_error("could not open file: " + path.string());
+  }
+}
+
+}  // namespace detail
+
+// Input iterator that removes comments from a character sequence while it is read.
+// Line comments are replaced with the terminating newline and block comments with a space
+// followed by the newlines they contain, so that parser error positions keep their line numbers.
+template <typename Iterator>
+class jsonc_iterator
+{
+public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = char;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const char*;
+  using reference = const char&;
+
+  jsonc_iterator() = default;
+
+  jsonc_iterator(Iterator begin, Iterator end)
+    : it_(std::move(begin)), end_(std::move(end)), eof_(false)
+  {
+    next();
+  }
+
+  reference operator*() const noexcept
+  {
+    return c_;
+  }
+
+  pointer operator->() const noexcept
+  {
+    return &c_;
+  }
+
+  jsonc_iterator& operator++()
+  {
+    next();
+    return *this;
+  }
+
+  void operator++(int)
+  {
+    next();
+  }
+
+  bool operator==(const jsonc_iterator& other) const noexcept
+  {
+    return eof_ == other.eof_;
+  }
+
+  bool operator!=(const jsonc_iterator& other) const noexcept
+  {
+    return eof_ != other.eof_;
+  }
+
+private:
+  using lexer = detail::jsonc_lexer;
+
+  void next()
+  {
+    while (it_ != end_) {
+      const char c = *it_;
+      ++it_;
+      switch (const auto output = lexer_.next(c)) {
+      case lexer::action::keep:
+        c_ = c;
+        return;
+      case lexer::action::blank:
         continue;
-      case state::end:
-        break;
+      case lexer::action::space:
+        c_ = ' ';
+        return;
+      default:
+        lexer::raise(output);
+      }
+    }
+    lexer_.finish();
+    eof_ = true;
+  }
+
+  Iterator it_ = {};
+  Iterator end_ = {};
+  lexer lexer_;
+  char c_ = '\0';
+  bool eof_ = true;
+};
+
+// Replaces comments with spaces in place. Newlines in block comments are kept.
+inline void strip(char* it, char* end)
+{
+  using state = detail::jsonc_lexer::state;
+  using action = detail::jsonc_lexer::action;
+  detail::jsonc_lexer lexer;
+  while (true) {
+    // Skip over runs of characters that cannot change the state.
+    switch (lexer.get()) {
+    case state::code:
+      it = detail::find(it, end, '"', '/');
+      break;
+    case state::string:
+      it = detail::find(it, end, '"', '\\');
+      break;
+    case state::line:
+      if (const auto eol = std::memchr(it, '\n', static_cast<std::size_t>(end - it))) {
+        std::memset(it, ' ', static_cast<std::size_t>(static_cast<char*>(eol) - it));
+        it = static_cast<char*>(eol);
+      }
+      else {
+        std::memset(it, ' ', static_cast<std::size_t>(end - it));
+        it = end;
       }
-      size++;
+      break;
+    default:
+      break;
     }
-    ss.write(line.data(), size);
+    if (it == end) {
+      break;
+    }
+    switch (const auto output = lexer.next(*it)) {
+    case action::keep:
+      break;
+    case action::blank:
+    case action::space:
+      *it = ' ';
+      break;
+    default:
+      detail::jsonc_lexer::raise(output);
+    }
+    ++it;
   }
-  return json::parse(std::move(ss));
+  lexer.finish();
+}
+
+inline json parse(std::istream& is)
+{
+  using iterator = jsonc_iterator<std::istreambuf_iterator<char>>;
+  return json::parse(iterator(std::istreambuf_iterator<char>(is), {}), iterator());
 }
 
 inline json parse(const std::filesystem::path& path)
 {
-  std::ifstream is(path, std::ios::binary);
-  if (!is) {
-    throw std::domain_error("could not open file: " + path.string());
+  auto file = detail::open(path);
+  strip(file.data(), file.data() + file.size());
+  return json::parse(file.data(), file.data() + file.size());
+}
+
+// Parses the file and keeps a binary copy of the result in the cache file.
+// The cache holds a SHA-256 digest of the source and the document as MessagePack. It is used
+// instead of the source when the digest matches and rewritten when it does not.
+inline json parse(const std::filesystem::path& path, const std::filesystem::path& cache)
+{
+  constexpr char magic[8] = { 'I', 'C', 'E', 'J', 'S', 'O', 'N', '1' };
+  constexpr std::size_t header = sizeof(magic) + 32;
+
+  auto file = detail::open(path);
+  ice::sha256 sha256;
+  sha256.feed(file.data(), file.size());
+  unsigned char digest[32];
+  sha256.store_unsafe(digest);
+
+  if (std::error_code ec; std::filesystem::is_regular_file(cache, ec)) {
+    try {
+      const ice::mapped_file data(cache);
+      const auto src = reinterpret_cast<const std::uint8_t*>(data.data());
+      if (
+        data.size() > header && std::memcmp(src, magic, sizeof(magic)) == 0 &&
+        std::memcmp(src + sizeof(magic), digest, sizeof(digest)) == 0) {
+        return json::from_msgpack(src + header, src + data.size());
+      }
+    }
+    catch (const std::exception&) {
+      // Fall back to the source file.
+    }
+  }
+
+  strip(file.data(), file.data() + file.size());
+  auto config = json::parse(file.data(), file.data() + file.size());
+
+  // Write to a unique temporary file and rename it so that concurrent readers never see a
+  // partially written cache.
+  auto temp = cache;
+  temp += "." + ice::uuid::generate().str();
+  std::ofstream os(temp, std::ios::binary);
+  os.write(magic, sizeof(magic));
+  os.write(reinterpret_cast<const char*>(digest), sizeof(digest));
+  json::to_msgpack(config, os);
+  os.close();
+  std::error_code ec;
+  if (os) {
+    std::filesystem::rename(temp, cache, ec);
+  }
+  if (!os || ec) {
+    std::filesystem::remove(temp, ec);
   }
-  return parse(static_cast<std::istream&>(is));
+  return config;
 }
 
 inline json parse(const std::string& s)
 {
-  std::istringstream is(s);
-  return parse(static_cast<std::istream&>(is));
+  using iterator = jsonc_iterator<std::string::const_iterator>;
+  return json::parse(iterator(s.begin(), s.end()), iterator());
 }
 
 }  // namespace config
@@ -1,8 +1,15 @@
 #pragma once
 #include <ice/exception.hpp>
 #include <ice/log/sink.hpp>
+#include <ice/result.hpp>
 #include <memory>
+#include <optional>
+#include <source_location>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace ice {
 namespace log {
@@ -10,9 +17,75 @@ namespace log {
 void add(std::shared_ptr<ice::log::sink> sink);
 void remove(std::shared_ptr<ice::log::sink> sink);
 
+// Settings of the thread that writes messages to the sinks.
+struct options {
+  std::string thread_name = "log";  // truncated to 15 characters on Linux
+  std::vector<unsigned> affinity;   // processors the thread may run on or empty to inherit
+  std::optional<int> nice;          // niceness from -20 (highest) to 19 (lowest priority)
+  bool lazy = true;                 // start on the first message instead of in configure()
+};
+
+// Applies the options to the logger thread. Settings that cannot be applied are logged as
+// warnings. Starts the thread unless options.lazy is set, which keeps thread creation out of
+// the first code path that logs.
+void configure(options options);
+
 std::string format(time_point tp, bool date = true, bool milliseconds = true);
 std::string format(severity s, bool padding = true);
 
+// Returns the context entries from the outermost scope as "key=value" pairs.
+std::string format(const context& context);
+
+// Returns the selected optional fields of the message separated by spaces.
+std::string format(const message& message, fields fields);
+
+// Returns the log context of the calling thread.
+std::shared_ptr<const context> capture() noexcept;
+
+// Replaces the log context of the calling thread.
+void restore(std::shared_ptr<const context> context) noexcept;
+
+// Adds a key and value to the log context of the calling thread until the scope ends.
+// Messages capture the context when they are created. To carry it to another thread or into a
+// resumed coroutine, call capture() before the handoff and construct a scope from the result.
+class scope
+{
+public:
+  template <typename T>
+  scope(std::string key, const T& value) : previous_(capture())
+  {
+    restore(std::make_shared<const context>(context{ std::move(key), str(value), previous_ }));
+  }
+
+  explicit scope(std::shared_ptr<const context> context) noexcept : previous_(capture())
+  {
+    restore(std::move(context));
+  }
+
+  scope(scope&& other) = delete;
+  scope& operator=(scope&& other) = delete;
+
+  ~scope()
+  {
+    restore(std::move(previous_));
+  }
+
+private:
+  template <typename T>
+  static std::string str(const T& value)
+  {
+    if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+      return std::string(std::string_view(value));
+    } else {
+      std::ostringstream oss;
+      oss << value;
+      return oss.str();
+    }
+  }
+
+  std::shared_ptr<const context> previous_;
+};
+
 class stream : public std::stringbuf,
 #if defined(__GNUC__) && !defined(__clang__)
                private
@@ -22,7 +95,8 @@ class stream : public std::stringbuf,
                std::ostream
 {
 public:
-  explicit stream(severity severity);
+  explicit stream(
+    severity severity, std::source_location location = std::source_location::current());
 
   stream(stream&& other);
   stream& operator=(stream&& other);
@@ -38,16 +112,35 @@ public:
 
   stream& operator<<(const std::error_code& ec);
   stream& operator<<(const std::exception_ptr& e);
+  stream& operator<<(const ice::error& e);
+
+  // Writes the value or the error.
+  template <typename T, typename E>
+  stream& operator<<(const ice::result<T, E>& r)
+  {
+    if (!r) {
+      return *this << r.error();
+    }
+    if constexpr (!std::is_void_v<T>) {
+      *this << *r;
+    }
+    return *this;
+  }
 
 private:
   severity severity_ = severity::info;
   time_point time_point_ = clock::now();
+  std::chrono::steady_clock::time_point steady_time_point_ = std::chrono::steady_clock::now();
+  std::shared_ptr<const log::context> context_ = capture();
+  std::source_location location_;
 };
 
 class emergency : public stream
 {
 public:
-  emergency() : stream(severity::emergency) {}
+  emergency(std::source_location location = std::source_location::current())
+    : stream(severity::emergency, location)
+  {}
 
   template <typename T>
   emergency& operator<<(const T& v)
@@ -60,7 +153,9 @@ public:
 class critical : public stream
 {
 public:
-  critical() : stream(severity::critical) {}
+  critical(std::source_location location = std::source_location::current())
+    : stream(severity::critical, location)
+  {}
 
   template <typename T>
   critical& operator<<(const T& v)
@@ -73,7 +168,9 @@ public:
 class error : public stream
 {
 public:
-  error() : stream(severity::error) {}
+  error(std::source_location location = std::source_location::current())
+    : stream(severity::error, location)
+  {}
 
   template <typename T>
   error& operator<<(const T& v)
@@ -86,7 +183,9 @@ public:
 class warning : public stream
 {
 public:
-  warning() : stream(severity::warning) {}
+  warning(std::source_location location = std::source_location::current())
+    : stream(severity::warning, location)
+  {}
 
   template <typename T>
   warning& operator<<(const T& v)
@@ -99,7 +198,9 @@ public:
 class notice : public stream
 {
 public:
-  notice() : stream(severity::notice) {}
+  notice(std::source_location location = std::source_location::current())
+    : stream(severity::notice, location)
+  {}
 
   template <typename T>
   notice& operator<<(const T& v)
@@ -112,7 +213,9 @@ public:
 class info : public stream
 {
 public:
-  info() : stream(severity::info) {}
+  info(std::source_location location = std::source_location::current())
+    : stream(severity::info, location)
+  {}
 
   template <typename T>
   info& operator<<(const T& v)
@@ -125,7 +228,9 @@ public:
 class debug : public stream
 {
 public:
-  debug() : stream(severity::debug) {}
+  debug(std::source_location location = std::source_location::current())
+    : stream(severity::debug, location)
+  {}
 
   template <typename T>
   debug& operator<<(const T& v)
@@ -8,7 +8,11 @@ namespace log {
 class console : public sink
 {
 public:
-  console(severity severity = severity::debug, bool date = true, bool milliseconds = true);
+  console(
+    severity severity = severity::debug,
+    bool date = true,
+    bool milliseconds = true,
+    log::fields fields = log::fields::none);
   virtual ~console();
 
   void write(const std::vector<message>& messages) override;
@@ -13,7 +13,8 @@ public:
     const std::filesystem::path& filename,
     severity severity = severity::debug,
     bool date = true,
-    bool milliseconds = true);
+    bool milliseconds = true,
+    log::fields fields = log::fields::none);
 
   virtual ~file();
 
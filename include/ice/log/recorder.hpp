@@ -0,0 +1,46 @@
+#pragma once
+#include <ice/log/sink.hpp>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+namespace ice {
+namespace log {
+
+// Sink that keeps the most recent messages of all severities LZ4 compressed in memory and
+// writes them to a file when a message with the trigger severity or higher is logged, when the
+// process receives SIGUSR1 and when it crashes with SIGSEGV, SIGBUS, SIGFPE, SIGILL or SIGABRT.
+// Each dump replaces the file. Crash dumps are written to the file name with ".crash" appended,
+// so that they cannot collide with a dump that is in progress when the process crashes.
+// Dumps caused by messages are written at most once per second; a dump that is due later is
+// written by the logger thread when the second passed.
+// Only the first recorder that is constructed handles signals. It gives the constructing thread
+// an alternate signal stack unless it has one, so that a stack overflow on that thread is dumped.
+// Other threads need their own alternate stack (sigaltstack) for that.
+class recorder : public sink
+{
+public:
+  recorder(
+    const std::filesystem::path& filename,
+    std::size_t capacity = 16 * 1024 * 1024,
+    severity trigger = severity::error);
+
+  virtual ~recorder();
+
+  void write(const std::vector<message>& messages) override;
+
+  std::chrono::steady_clock::time_point deadline() const override;
+
+  // Reads the messages of a dump. Skips damaged chunks.
+  // Throws ice::system_error or ice::runtime_error if the file is not a dump.
+  static std::vector<record> load(const std::filesystem::path& filename);
+
+private:
+  class impl;
+  std::unique_ptr<impl> impl_;
+};
+
+}  // namespace log
+}  // namespace ice
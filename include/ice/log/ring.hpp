@@ -0,0 +1,92 @@
+#pragma once
+#include <ice/log/sink.hpp>
+#include <filesystem>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// Ring file layout. All integers use the byte order of the writer.
+//
+// Header (128 bytes):
+//   0  char[8]  magic "ICERING1"
+//   8  u32      version (1)
+//   12 u32      header size (128)
+//   16 u64      capacity of the data area in bytes, a power of two
+//   24 u64      writer process id or 0 after the writer closed the ring
+//   64 u64      head: position after the newest record
+//   72 u64      tail: position of the oldest record
+//
+// Positions only grow. The record at position p starts at byte 128 + (p & (capacity - 1)).
+// Records are 8 byte aligned and never wrap; a padding record fills the end of the data area.
+//
+// Record (48 bytes followed by the file name, context and text, padded to 8 bytes):
+//   0  u32      size of the record including the padding
+//   4  u8       type: 0 = message, 1 = padding (only the size is valid)
+//   5  u8       severity
+//   6  u16      file name size
+//   8  u64      sequence number, incremented by one for every message
+//   16 i64      system clock time in nanoseconds since the epoch
+//   24 i64      steady clock time in nanoseconds
+//   32 u32      thread id
+//   36 u32      line
+//   40 u32      context size ("key=value" pairs separated by spaces)
+//   44 u32      text size
+//
+// The single writer publishes a record by storing the head after the record is complete.
+// When the ring is full, it stores the new tail before it overwrites the oldest records.
+// Readers never write to the file: they copy a record and then check that the tail did not
+// pass it. The records between tail and head stay valid when the writer crashes.
+
+namespace ice {
+namespace log {
+
+// Sink that writes messages into a memory mapped ring file, usually in /dev/shm, so that other
+// processes can read them with ice::log::ring_reader. Overwrites the oldest records when the
+// ring is full and never blocks. An existing ring with the same capacity is continued, so the
+// messages of a crashed process stay available. The file is not removed by the destructor.
+class ring : public sink
+{
+public:
+  ring(
+    const std::filesystem::path& filename,
+    std::size_t capacity = 4 * 1024 * 1024,
+    severity severity = severity::debug);
+
+  virtual ~ring();
+
+  void write(const std::vector<message>& messages) override;
+
+private:
+  class impl;
+  std::unique_ptr<impl> impl_;
+};
+
+// Reads the records of a ring file while the writer is running or after it exited or crashed.
+// Reading does not modify the file or make system calls.
+class ring_reader
+{
+public:
+  // Maps the ring file. Throws ice::system_error or ice::runtime_error on failure.
+  explicit ring_reader(const std::filesystem::path& filename);
+
+  ring_reader(ring_reader&& other) noexcept;
+  ring_reader& operator=(ring_reader&& other) noexcept;
+
+  ~ring_reader();
+
+  // Reads the oldest unread record. Returns false if there is none.
+  bool read(record& record);
+
+  // Returns the number of records that were overwritten before they could be read.
+  std::uint64_t lost() const noexcept;
+
+  // Returns the process id of the writer or 0 if it closed the ring.
+  std::uint64_t pid() const noexcept;
+
+private:
+  class impl;
+  std::unique_ptr<impl> impl_;
+};
+
+}  // namespace log
+}  // namespace ice
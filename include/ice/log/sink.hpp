@@ -1,7 +1,11 @@
 #pragma once
+#include <ice/bitmask.hpp>
 #include <chrono>
+#include <memory>
+#include <source_location>
 #include <string>
 #include <vector>
+#include <cstdint>
 
 namespace ice {
 namespace log {
@@ -20,11 +24,46 @@ enum class severity {
   debug = 7,
 };
 
+// Optional message fields written by sinks.
+enum class fields : unsigned {
+  none = 0x00,
+  steady = 0x01,    // steady clock time in seconds, for latencies between messages
+  thread = 0x02,    // operating system thread id
+  location = 0x04,  // source file name and line
+};
+
+// Entry of a log context. Entries are immutable and link to the entry of the enclosing scope,
+// so that messages and other threads can share a context without copying it.
+struct context
+{
+  std::string key;
+  std::string value;
+  std::shared_ptr<const context> parent;
+};
+
 struct message
 {
   log::time_point time_point;
   log::severity severity;
   std::string text;
+  std::shared_ptr<const log::context> context;
+  std::chrono::steady_clock::time_point steady_time_point;
+  std::source_location location;
+  std::uint32_t thread = 0;
+};
+
+// Message read back from a ring file or a recorder dump.
+struct record
+{
+  std::uint64_t sequence = 0;
+  log::time_point time_point;
+  std::chrono::steady_clock::time_point steady_time_point;
+  log::severity severity = log::severity::debug;
+  std::uint32_t thread = 0;
+  std::string file;
+  std::uint32_t line = 0;
+  std::string context;
+  std::string text;
 };
 
 class sink
@@ -32,6 +71,13 @@ class sink
 public:
   virtual ~sink() = default;
   virtual void write(const std::vector<ice::log::message>& messages) = 0;
+
+  // Returns the time at which the logger thread calls write() without messages if no messages
+  // arrive earlier. Called on the logger thread after every write().
+  virtual std::chrono::steady_clock::time_point deadline() const
+  {
+    return std::chrono::steady_clock::time_point::max();
+  }
 };
 
 class null : public sink
@@ -42,3 +88,9 @@ public:
 
 }  // namespace log
 }  // namespace ice
+
+template <>
+struct enable_bitmask_operators<ice::log::fields>
+{
+  static const bool value = true;
+};
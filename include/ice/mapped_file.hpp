@@ -0,0 +1,56 @@
+#pragma once
+#include <filesystem>
+#include <string_view>
+#include <cstddef>
+
+namespace ice {
+
+// Private memory mapping of a file.
+// Writes to the mapped memory are copy-on-write and never reach the file.
+// Use it for files that do not change while they are mapped: if another process truncates the
+// file, reading mapped pages past the new end raises SIGBUS. Read files that may be rewritten
+// concurrently, such as watched config files, into a buffer instead.
+// Files that cannot be mapped, such as /proc and /sys files, pipes and /dev/stdin, are read into
+// an anonymous mapping instead.
+class mapped_file
+{
+public:
+  mapped_file() noexcept = default;
+
+  // Maps the whole file. Throws ice::system_error on failure.
+  explicit mapped_file(const std::filesystem::path& path);
+
+  mapped_file(mapped_file&& other) noexcept;
+  mapped_file& operator=(mapped_file&& other) noexcept;
+
+  mapped_file(const mapped_file& other) = delete;
+  mapped_file& operator=(const mapped_file& other) = delete;
+
+  ~mapped_file();
+
+  char* data() noexcept
+  {
+    return data_;
+  }
+
+  const char* data() const noexcept
+  {
+    return data_;
+  }
+
+  std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  std::string_view view() const noexcept
+  {
+    return { data_, size_ };
+  }
+
+private:
+  char* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+}  // namespace ice
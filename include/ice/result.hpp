@@ -0,0 +1,234 @@
+#pragma once
+#include <ice/exception.hpp>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace ice {
+
+// Error value with the same data as an ice::exception_stream: a message, additional
+// information and an optional error code. Returning it does not unwind the stack.
+class error
+{
+public:
+  using endl = detail::info_stream::endl;
+
+  explicit error(std::string what) : what_(std::move(what)) {}
+
+  error(std::error_code code, std::string what) : code_(code), what_(std::move(what)) {}
+
+  // Takes the message, information and error code of the exception.
+  explicit error(const std::exception_ptr& e);
+
+  template <typename V>
+  error& operator<<(const V& v)
+  {
+    info_.write(v);
+    return *this;
+  }
+
+  error& operator<<(endl)
+  {
+    info_.write(endl{});
+    return *this;
+  }
+
+  const char* what() const noexcept
+  {
+    return what_.c_str();
+  }
+
+  const char* info() const noexcept
+  {
+    return info_.c_str();
+  }
+
+  const std::error_code& code() const noexcept
+  {
+    return code_;
+  }
+
+  // Throws an ice::system_error if the error has a code and an ice::runtime_error otherwise.
+  [[noreturn]] void raise() const;
+
+  // Returns the exception that raise() would throw.
+  std::exception_ptr exception() const noexcept;
+
+private:
+  std::error_code code_;
+  std::string what_;
+  detail::info_stream info_;
+};
+
+// Holds either a value or an error.
+template <typename T, typename E = ice::error>
+class result
+{
+public:
+  using value_type = T;
+  using error_type = E;
+
+  template <typename U = T>
+    requires(
+      std::is_constructible_v<T, U&&> && !std::is_same_v<std::remove_cvref_t<U>, result> &&
+      !std::is_same_v<std::remove_cvref_t<U>, E>)
+  result(U&& value) : value_(std::in_place_index<0>, std::forward<U>(value))
+  {}
+
+  result(E error) : value_(std::in_place_index<1>, std::move(error)) {}
+
+  bool has_value() const noexcept
+  {
+    return value_.index() == 0;
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return has_value();
+  }
+
+  // Returns the value or throws the error.
+  T& value() &
+  {
+    check();
+    return *std::get_if<0>(&value_);
+  }
+
+  const T& value() const&
+  {
+    check();
+    return *std::get_if<0>(&value_);
+  }
+
+  T&& value() &&
+  {
+    check();
+    return std::move(*std::get_if<0>(&value_));
+  }
+
+  template <typename U>
+  T value_or(U&& other) const&
+  {
+    return has_value() ? *std::get_if<0>(&value_) : static_cast<T>(std::forward<U>(other));
+  }
+
+  T& operator*() noexcept
+  {
+    return *std::get_if<0>(&value_);
+  }
+
+  const T& operator*() const noexcept
+  {
+    return *std::get_if<0>(&value_);
+  }
+
+  T* operator->() noexcept
+  {
+    return std::get_if<0>(&value_);
+  }
+
+  const T* operator->() const noexcept
+  {
+    return std::get_if<0>(&value_);
+  }
+
+  // Returns the error. The result must not have a value.
+  E& error() noexcept
+  {
+    return *std::get_if<1>(&value_);
+  }
+
+  const E& error() const noexcept
+  {
+    return *std::get_if<1>(&value_);
+  }
+
+private:
+  void check() const
+  {
+    if (const auto e = std::get_if<1>(&value_)) {
+      if constexpr (requires { e->raise(); }) {
+        e->raise();
+      }
+      else {
+        throw *e;
+      }
+    }
+  }
+
+  std::variant<T, E> value_;
+};
+
+// Holds nothing or an error.
+template <typename E>
+class result<void, E>
+{
+public:
+  using value_type = void;
+  using error_type = E;
+
+  result() = default;
+
+  result(E error) : error_(std::move(error)) {}
+
+  bool has_value() const noexcept
+  {
+    return !error_.has_value();
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return has_value();
+  }
+
+  // Throws the error if there is one.
+  void value() const
+  {
+    if (error_) {
+      if constexpr (requires { error_->raise(); }) {
+        error_->raise();
+      }
+      else {
+        throw *error_;
+      }
+    }
+  }
+
+  E& error() noexcept
+  {
+    return *error_;
+  }
+
+  const E& error() const noexcept
+  {
+    return *error_;
+  }
+
+private:
+  std::optional<E> error_;
+};
+
+// Calls the function and returns its result or the exception it threw as an error.
+template <typename F, typename T = std::invoke_result_t<F>>
+inline result<T> capture(F&& f)
+{
+  try {
+    if constexpr (std::is_void_v<T>) {
+      std::forward<F>(f)();
+      return {};
+    }
+    else {
+      return std::forward<F>(f)();
+    }
+  }
+  catch (...) {
+    return ice::error(std::current_exception());
+  }
+}
+
+}  // namespace ice
@@ -2,6 +2,7 @@
 // Please see LICENSE for license or visit https://github.com/taocpp/json/
 
 #pragma once
+#include <ice/base16.hpp>
 #include <string>
 #include <cstddef>
 #include <cstdint>
@@ -85,9 +86,23 @@ public:
   void feed(const void* p, std::size_t s) noexcept
   {
     const unsigned char* q = static_cast<const unsigned char*>(p);
-    while (s--) {
-      feed(*q++);
+    const std::size_t i = size % 64;
+    size += s;
+    if (i != 0) {
+      const std::size_t n = s < 64 - i ? s : 64 - i;
+      std::memcpy(M + i, q, n);
+      if (i + n != 64) {
+        return;
+      }
+      process();
+      q += n;
+      s -= n;
+    }
+    for (; s >= 64; q += 64, s -= 64) {
+      std::memcpy(M, q, 64);
+      process();
     }
+    std::memcpy(M, q, s);
   }
 
   void feed(const std::string& v) noexcept
@@ -148,15 +163,9 @@ public:
 
   std::string str()
   {
-    const auto data = get();
-    std::string str;
-    str.resize(64);
-    for (std::size_t i = 0; i < 32; i++) {
-      const auto c = static_cast<unsigned char>(data[i]);
-      str[i * 2 + 0] = to_ascii(c >> 4);
-      str[i * 2 + 1] = to_ascii(c & 0xF);
-    }
-    return str;
+    unsigned char buffer[32];
+    store_unsafe(buffer);
+    return base16::encode(std::basic_string_view<unsigned char>(buffer, sizeof(buffer)));
   }
 
 private:
@@ -209,11 +218,6 @@ private:
     H[7] += h;
   }
 
-  static char to_ascii(unsigned char c)
-  {
-    return c < 10 ? '0' + c : 'a' + c - 10;
-  }
-
   unsigned char M[64];
   std::size_t size = 0;
   std::uint32_t H[8];
@@ -0,0 +1,9 @@
+#pragma once
+
+// Defines ICE_SSE2 when SSE2 intrinsics can be used without runtime dispatch.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  ifndef ICE_NO_SIMD
+#    define ICE_SSE2 1
+#    include <emmintrin.h>
+#  endif
+#endif
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <cstddef>
+
+namespace ice {
+
+// Return addresses of a call stack. Capturing does not allocate or resolve symbols.
+// Symbols are resolved when the trace is converted to a string. On POSIX systems only exported
+// symbols are found: executables must be linked with -rdynamic, which the ice CMake target adds
+// to everything that links it. Frames without a symbol show the module and the offset in it
+// for addr2line.
+class stacktrace
+{
+public:
+  static constexpr std::size_t capacity = 32;
+
+  using const_iterator = void* const*;
+
+  // Captures the stack of the calling thread without the frame of this function.
+  static stacktrace current(std::size_t skip = 0) noexcept;
+
+  // Captures the stack of the calling thread when capturing is enabled.
+  static stacktrace capture() noexcept
+  {
+    return enabled() ? current() : stacktrace();
+  }
+
+  // Enables or disables capture() for the whole process. Disabled by default.
+  static void enable(bool enable) noexcept
+  {
+    enabled_.store(enable, std::memory_order_relaxed);
+  }
+
+  static bool enabled() noexcept
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  bool empty() const noexcept
+  {
+    return size_ == 0;
+  }
+
+  std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  const_iterator begin() const noexcept
+  {
+    return frames_;
+  }
+
+  const_iterator end() const noexcept
+  {
+    return frames_ + size_;
+  }
+
+  // Returns one line per frame with the address, symbol and module.
+  std::string str() const;
+
+private:
+  inline static std::atomic_bool enabled_ = false;
+
+  void* frames_[capacity];
+  std::size_t size_ = 0;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const stacktrace& trace)
+{
+  return os << trace.str();
+}
+
+}  // namespace ice
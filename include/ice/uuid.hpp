@@ -1,5 +1,8 @@
 #pragma once
+#include <array>
+#include <functional>
 #include <ostream>
+#include <span>
 #include <string>
 #include <string_view>
 #include <cstdint>
@@ -36,11 +39,33 @@ struct uuid
   // Formats the UUID.
   std::string str() const;
 
+  // Returns the canonical big-endian byte representation of the UUID.
+  std::array<std::uint8_t, 16> to_bytes() const noexcept;
+
+  // Creates a UUID from its canonical big-endian byte representation.
+  static uuid from_bytes(std::span<const std::uint8_t, 16> bytes) noexcept;
+
+  // Formats the UUID into a buffer without a terminating character.
+  void format(char (&buffer)[36]) const noexcept;
+
+  // Parses a string without throwing. Returns false if the string is not a UUID.
+  static bool parse(std::string_view str, uuid& uuid) noexcept;
+
   // Generates a random UUID (version 4).
   static uuid generate();
 
-  // Checks if the given string is a UUID.
+  // Fills the span with random UUIDs (version 4).
+  static void generate(std::span<uuid> uuids) noexcept;
+
+  // Generates a time-ordered UUID (version 7) with a millisecond Unix timestamp prefix.
+  // UUIDs generated by the same thread are strictly increasing.
+  static uuid generate_v7() noexcept;
+
+  // Checks if the given string is a UUID. Lowercase and uppercase digits are accepted.
   static bool check(std::string_view str) noexcept;
+
+  // Checks if all given strings are UUIDs.
+  static bool check_all(std::span<const std::string_view> strs) noexcept;
 };
 
 inline constexpr bool operator==(const ice::uuid& a, const ice::uuid& b)
@@ -53,24 +78,43 @@ inline constexpr bool operator!=(const ice::uuid& a, const ice::uuid& b)
   return !operator==(a, b);
 }
 
+// Compares UUIDs in the byte order of their string representation.
 inline constexpr bool operator<(const ice::uuid& a, const ice::uuid& b)
 {
-  return a.data.s[0] < b.data.s[0] || (a.data.s[0] == b.data.s[0] && a.data.s[1] < b.data.s[1]);
+  const auto ah =
+    std::uint64_t(a.data.v.tl) << 32 | std::uint64_t(a.data.v.tm) << 16 | a.data.v.thv;
+  const auto bh =
+    std::uint64_t(b.data.v.tl) << 32 | std::uint64_t(b.data.v.tm) << 16 | b.data.v.thv;
+  if (ah != bh) {
+    return ah < bh;
+  }
+  if (a.data.v.csr != b.data.v.csr) {
+    return a.data.v.csr < b.data.v.csr;
+  }
+  if (a.data.v.csl != b.data.v.csl) {
+    return a.data.v.csl < b.data.v.csl;
+  }
+  for (auto i = 0; i < 6; i++) {
+    if (a.data.v.n[i] != b.data.v.n[i]) {
+      return a.data.v.n[i] < b.data.v.n[i];
+    }
+  }
+  return false;
 }
 
 inline constexpr bool operator<=(const ice::uuid& a, const ice::uuid& b)
 {
-  return a == b || a < b;
+  return !operator<(b, a);
 }
 
 inline constexpr bool operator>(const ice::uuid& a, const ice::uuid& b)
 {
-  return a.data.s[0] > b.data.s[0] || (a.data.s[0] == b.data.s[0] && a.data.s[1] > b.data.s[1]);
+  return operator<(b, a);
 }
 
 inline constexpr bool operator>=(const ice::uuid& a, const ice::uuid& b)
 {
-  return a == b || a > b;
+  return !operator<(a, b);
 }
 
 inline std::ostream& operator<<(std::ostream& os, const ice::uuid& uuid)
@@ -79,3 +123,16 @@ inline std::ostream& operator<<(std::ostream& os, const ice::uuid& uuid)
 }
 
 }  // namespace ice
+
+template <>
+struct std::hash<ice::uuid>
+{
+  std::size_t operator()(const ice::uuid& uuid) const noexcept
+  {
+    // Multiply-xorshift mix of both halves (see splitmix64).
+    auto h = uuid.data.s[0] ^ (uuid.data.s[1] * 0x9E3779B97F4A7C15);
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EB;
+    return static_cast<std::size_t>(h ^ (h >> 31));
+  }
+};
@@ -0,0 +1,452 @@
+#pragma once
+#include <ice/simd.hpp>
+#include <ice/uuid.hpp>
+#include <bit>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ice {
+namespace detail {
+
+// Open addressing hash table for UUID keys.
+//
+// Slots are split into groups of 16. Every slot has a control byte that is either empty, deleted
+// or holds the 7 low bits of the key hash. A lookup compares the control bytes of a whole group
+// at once and only touches slots whose control byte matches. Groups are probed quadratically.
+template <typename Value>
+class uuid_table
+{
+  static constexpr bool map = !std::is_same_v<Value, ice::uuid>;
+
+  template <bool Const>
+  class basic_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Value;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const Value*, Value*>;
+    using reference = std::conditional_t<Const, const Value&, Value&>;
+
+    basic_iterator() noexcept = default;
+
+    basic_iterator(const std::int8_t* ctrl, const std::int8_t* end, pointer slot) noexcept
+      : ctrl_(ctrl), end_(end), slot_(slot)
+    {
+      skip();
+    }
+
+    operator basic_iterator<true>() const noexcept requires(!Const)
+    {
+      return { ctrl_, end_, slot_ };
+    }
+
+    reference operator*() const noexcept
+    {
+      return *slot_;
+    }
+
+    pointer operator->() const noexcept
+    {
+      return slot_;
+    }
+
+    basic_iterator& operator++() noexcept
+    {
+      ++ctrl_;
+      ++slot_;
+      skip();
+      return *this;
+    }
+
+    basic_iterator operator++(int) noexcept
+    {
+      auto it = *this;
+      ++*this;
+      return it;
+    }
+
+    bool operator==(const basic_iterator& other) const noexcept
+    {
+      return ctrl_ == other.ctrl_;
+    }
+
+  private:
+    void skip() noexcept
+    {
+      while (ctrl_ != end_ && *ctrl_ < 0) {
+        ++ctrl_;
+        ++slot_;
+      }
+    }
+
+    const std::int8_t* ctrl_ = nullptr;
+    const std::int8_t* end_ = nullptr;
+    pointer slot_ = nullptr;
+  };
+
+public:
+  using key_type = ice::uuid;
+  using value_type = Value;
+  using size_type = std::size_t;
+  using const_iterator = basic_iterator<true>;
+  using iterator = std::conditional_t<map, basic_iterator<false>, const_iterator>;
+
+  uuid_table() noexcept = default;
+
+  uuid_table(uuid_table&& other) noexcept
+  {
+    swap(other);
+  }
+
+  uuid_table(const uuid_table& other)
+  {
+    if (other.size_ == 0) {
+      return;
+    }
+    reserve(other.size_);
+    for (const auto& value : other) {
+      insert_unique(key(value), value);
+    }
+  }
+
+  uuid_table& operator=(uuid_table&& other) noexcept
+  {
+    uuid_table(std::move(other)).swap(*this);
+    return *this;
+  }
+
+  uuid_table& operator=(const uuid_table& other)
+  {
+    if (this != &other) {
+      uuid_table(other).swap(*this);
+    }
+    return *this;
+  }
+
+  ~uuid_table()
+  {
+    clear();
+    std::allocator<Value>().deallocate(slots_, capacity_);
+    delete[] ctrl_;
+  }
+
+  iterator begin() noexcept
+  {
+    return { ctrl_, ctrl_ + capacity_, slots_ };
+  }
+
+  const_iterator begin() const noexcept
+  {
+    return { ctrl_, ctrl_ + capacity_, slots_ };
+  }
+
+  iterator end() noexcept
+  {
+    return { ctrl_ + capacity_, ctrl_ + capacity_, slots_ + capacity_ };
+  }
+
+  const_iterator end() const noexcept
+  {
+    return { ctrl_ + capacity_, ctrl_ + capacity_, slots_ + capacity_ };
+  }
+
+  size_type size() const noexcept
+  {
+    return size_;
+  }
+
+  bool empty() const noexcept
+  {
+    return size_ == 0;
+  }
+
+  size_type capacity() const noexcept
+  {
+    return capacity_;
+  }
+
+  void clear() noexcept
+  {
+    for (size_type i = 0; i < capacity_; i++) {
+      if (ctrl_[i] >= 0) {
+        std::destroy_at(slots_ + i);
+      }
+    }
+    if (capacity_) {
+      std::memset(ctrl_, ctrl_empty, capacity_);
+    }
+    growth_ = capacity_ - capacity_ / 8;
+    size_ = 0;
+  }
+
+  // Makes room for count elements without rehashing.
+  void reserve(size_type count)
+  {
+    auto capacity = capacity_ ? capacity_ : group_size;
+    while (capacity - capacity / 8 < count) {
+      capacity *= 2;
+    }
+    if (capacity != capacity_) {
+      rehash(capacity);
+    }
+  }
+
+  iterator find(const ice::uuid& uuid) noexcept
+  {
+    const auto i = lookup(uuid);
+    return i == npos ? end() : iterator(ctrl_ + i, ctrl_ + capacity_, slots_ + i);
+  }
+
+  const_iterator find(const ice::uuid& uuid) const noexcept
+  {
+    const auto i = lookup(uuid);
+    return i == npos ? end() : const_iterator(ctrl_ + i, ctrl_ + capacity_, slots_ + i);
+  }
+
+  bool contains(const ice::uuid& uuid) const noexcept
+  {
+    return lookup(uuid) != npos;
+  }
+
+  size_type erase(const ice::uuid& uuid) noexcept
+  {
+    const auto i = lookup(uuid);
+    if (i == npos) {
+      return 0;
+    }
+    std::destroy_at(slots_ + i);
+    size_--;
+
+    // The slot can only become empty when the group already stops every probe sequence.
+    if (match(ctrl_ + i / group_size * group_size, ctrl_empty)) {
+      ctrl_[i] = ctrl_empty;
+      growth_++;
+    } else {
+      ctrl_[i] = ctrl_deleted;
+    }
+    return 1;
+  }
+
+  void swap(uuid_table& other) noexcept
+  {
+    std::swap(ctrl_, other.ctrl_);
+    std::swap(slots_, other.slots_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(size_, other.size_);
+    std::swap(growth_, other.growth_);
+  }
+
+protected:
+  template <typename... Args>
+  std::pair<iterator, bool> emplace_unique(const ice::uuid& uuid, Args&&... args)
+  {
+    if (const auto i = lookup(uuid); i != npos) {
+      return { iterator(ctrl_ + i, ctrl_ + capacity_, slots_ + i), false };
+    }
+    if (growth_ == 0) {
+      rehash(size_ < capacity_ / 2 ? capacity_ : (capacity_ ? capacity_ * 2 : group_size));
+    }
+    const auto i = insert_unique(uuid, std::forward<Args>(args)...);
+    return { iterator(ctrl_ + i, ctrl_ + capacity_, slots_ + i), true };
+  }
+
+private:
+  static constexpr size_type group_size = 16;
+  static constexpr size_type npos = static_cast<size_type>(-1);
+  static constexpr std::int8_t ctrl_empty = -128;
+  static constexpr std::int8_t ctrl_deleted = -2;
+
+  static const ice::uuid& key(const Value& value) noexcept
+  {
+    if constexpr (map) {
+      return value.first;
+    } else {
+      return value;
+    }
+  }
+
+  // Returns a bit mask of the control bytes in the group that are equal to the given value.
+  static std::uint32_t match(const std::int8_t* group, std::int8_t value) noexcept
+  {
+#ifdef ICE_SSE2
+    const auto ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    const auto mask = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value)));
+    return static_cast<std::uint32_t>(mask);
+#else
+    std::uint32_t mask = 0;
+    for (size_type i = 0; i < group_size; i++) {
+      mask |= static_cast<std::uint32_t>(group[i] == value) << i;
+    }
+    return mask;
+#endif
+  }
+
+  // Returns a bit mask of the empty or deleted control bytes in the group.
+  static std::uint32_t match_free(const std::int8_t* group) noexcept
+  {
+#ifdef ICE_SSE2
+    const auto ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(ctrl));
+#else
+    std::uint32_t mask = 0;
+    for (size_type i = 0; i < group_size; i++) {
+      mask |= static_cast<std::uint32_t>(group[i] < 0) << i;
+    }
+    return mask;
+#endif
+  }
+
+  size_type lookup(const ice::uuid& uuid) const noexcept
+  {
+    if (size_ == 0) {
+      return npos;
+    }
+    const auto hash = std::hash<ice::uuid>()(uuid);
+    const auto h2 = static_cast<std::int8_t>(hash & 0x7F);
+    const auto groups = capacity_ / group_size;
+    auto group = (hash >> 7) & (groups - 1);
+    for (size_type step = 1;; step++) {
+      const auto ctrl = ctrl_ + group * group_size;
+      for (auto mask = match(ctrl, h2); mask; mask &= mask - 1) {
+        const auto i = group * group_size + static_cast<size_type>(std::countr_zero(mask));
+        if (key(slots_[i]) == uuid) {
+          return i;
+        }
+      }
+      if (match(ctrl, ctrl_empty)) {
+        return npos;
+      }
+      group = (group + step) & (groups - 1);
+    }
+  }
+
+  // Inserts a value that is not in the table. Requires growth_ to be greater than zero.
+  template <typename... Args>
+  size_type insert_unique(const ice::uuid& uuid, Args&&... args)
+  {
+    const auto hash = std::hash<ice::uuid>()(uuid);
+    const auto groups = capacity_ / group_size;
+    auto group = (hash >> 7) & (groups - 1);
+    for (size_type step = 1;; step++) {
+      if (const auto mask = match_free(ctrl_ + group * group_size)) {
+        const auto i = group * group_size + static_cast<size_type>(std::countr_zero(mask));
+        if constexpr (sizeof...(Args) == 1 && (std::is_same_v<std::decay_t<Args>, Value> && ...)) {
+          std::construct_at(slots_ + i, std::forward<Args>(args)...);
+        } else if constexpr (map) {
+          std::construct_at(
+            slots_ + i,
+            std::piecewise_construct,
+            std::forward_as_tuple(uuid),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        } else {
+          std::construct_at(slots_ + i, uuid);
+        }
+        if (ctrl_[i] == ctrl_empty) {
+          growth_--;
+        }
+        ctrl_[i] = static_cast<std::int8_t>(hash & 0x7F);
+        size_++;
+        return i;
+      }
+      group = (group + step) & (groups - 1);
+    }
+  }
+
+  void rehash(size_type capacity)
+  {
+    uuid_table table;
+    table.ctrl_ = new std::int8_t[capacity];
+    table.slots_ = std::allocator<Value>().allocate(capacity);
+    table.capacity_ = capacity;
+    std::memset(table.ctrl_, ctrl_empty, capacity);
+    table.growth_ = capacity - capacity / 8;
+    for (size_type i = 0; i < capacity_; i++) {
+      if (ctrl_[i] >= 0) {
+        table.insert_unique(key(slots_[i]), std::move(slots_[i]));
+        std::destroy_at(slots_ + i);
+        ctrl_[i] = ctrl_empty;
+      }
+    }
+    swap(table);
+  }
+
+  std::int8_t* ctrl_ = nullptr;
+  Value* slots_ = nullptr;
+  size_type capacity_ = 0;
+  size_type size_ = 0;
+  size_type growth_ = 0;
+};
+
+}  // namespace detail
+
+// Hash set of UUIDs.
+class uuid_set : public detail::uuid_table<ice::uuid>
+{
+public:
+  std::pair<iterator, bool> insert(const ice::uuid& uuid)
+  {
+    return emplace_unique(uuid);
+  }
+};
+
+// Hash map with UUID keys.
+template <typename T>
+class uuid_map : public detail::uuid_table<std::pair<const ice::uuid, T>>
+{
+  using base = detail::uuid_table<std::pair<const ice::uuid, T>>;
+
+public:
+  using mapped_type = T;
+  using typename base::iterator;
+  using typename base::value_type;
+
+  std::pair<iterator, bool> insert(const value_type& value)
+  {
+    return this->emplace_unique(value.first, value);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value)
+  {
+    return this->emplace_unique(value.first, std::move(value));
+  }
+
+  // Constructs the value in place if the key is not in the map.
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(const ice::uuid& uuid, Args&&... args)
+  {
+    return this->emplace_unique(uuid, std::forward<Args>(args)...);
+  }
+
+  T& operator[](const ice::uuid& uuid)
+  {
+    return this->emplace_unique(uuid).first->second;
+  }
+
+  T& at(const ice::uuid& uuid)
+  {
+    const auto it = this->find(uuid);
+    if (it == this->end()) {
+      throw std::out_of_range("uuid_map key not found");
+    }
+    return it->second;
+  }
+
+  const T& at(const ice::uuid& uuid) const
+  {
+    const auto it = this->find(uuid);
+    if (it == this->end()) {
+      throw std::out_of_range("uuid_map key not found");
+    }
+    return it->second;
+  }
+};
+
+}  // namespace ice
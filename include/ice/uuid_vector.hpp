@@ -0,0 +1,85 @@
+#pragma once
+#include <ice/uuid.hpp>
+#include <array>
+#include <span>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace ice {
+
+// Contiguous storage of UUIDs in their canonical big-endian byte representation.
+// Byte-wise comparison of the stored values matches the order of ice::uuid.
+class uuid_vector
+{
+public:
+  using value_type = std::array<std::uint8_t, 16>;
+  using size_type = std::size_t;
+
+  static constexpr size_type npos = static_cast<size_type>(-1);
+
+  uuid_vector() = default;
+  explicit uuid_vector(std::span<const uuid> uuids);
+
+  size_type size() const noexcept
+  {
+    return values_.size();
+  }
+
+  bool empty() const noexcept
+  {
+    return values_.empty();
+  }
+
+  void reserve(size_type size)
+  {
+    values_.reserve(size);
+  }
+
+  void clear() noexcept
+  {
+    values_.clear();
+  }
+
+  void push_back(const uuid& uuid)
+  {
+    values_.push_back(uuid.to_bytes());
+  }
+
+  void push_back(const value_type& bytes)
+  {
+    values_.push_back(bytes);
+  }
+
+  uuid operator[](size_type index) const noexcept
+  {
+    return uuid::from_bytes(values_[index]);
+  }
+
+  std::span<const value_type> values() const noexcept
+  {
+    return values_;
+  }
+
+  // Sorts the UUIDs with a least significant digit radix sort.
+  // Byte positions that are equal for all UUIDs are skipped.
+  void sort();
+
+  // Removes consecutive duplicates. Removes all duplicates when sorted.
+  void unique() noexcept;
+
+  // Returns the index of the first occurrence of the UUID or npos.
+  size_type find(const uuid& uuid) const noexcept;
+
+  // Returns the index of the first UUID that is not less than the given one.
+  // Requires the vector to be sorted.
+  size_type lower_bound(const uuid& uuid) const noexcept;
+
+  // Returns true if the UUID is in the sorted vector.
+  bool contains_sorted(const uuid& uuid) const noexcept;
+
+private:
+  std::vector<value_type> values_;
+};
+
+}  // namespace ice
@@ -1,8 +1,20 @@
 #include <ice/application.hpp>
+#include <ice/exception.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <string_view>
+#include <vector>
 #ifdef _WIN32
 #  include <windows.h>
+#else
+#  include <pthread.h>
+#  include <unistd.h>
 #endif
 #ifdef __linux__
+#  include <sched.h>
+#  include <cerrno>
 #  include <limits.h>
 #  include <stdlib.h>
 #endif
@@ -13,6 +25,7 @@
 
 namespace ice {
 namespace application {
+namespace {
 
 // http://www.tech.theplayhub.com/finding_current_executables_path_without_procselfexe-7
 // =====================================================================================
@@ -24,7 +37,7 @@ namespace application {
 // NetBSD: readlink /proc/curproc/exe
 // DragonFly BSD: readlink /proc/curproc/file
 // Windows: GetModuleFileName() with hModule = NULL
-std::filesystem::path path()
+std::filesystem::path executable()
 {
 #ifdef _WIN32
   DWORD size = 0;
@@ -64,5 +77,426 @@ std::filesystem::path path()
 #endif
 }
 
+#ifdef __linux__
+
+std::string read_line(const std::filesystem::path& path)
+{
+  std::string line;
+  std::ifstream is(path);
+  std::getline(is, line);
+  return line;
+}
+
+std::vector<std::string_view> split(std::string_view s, char separator)
+{
+  std::vector<std::string_view> parts;
+  for (std::size_t pos = 0; pos <= s.size();) {
+    const auto end = std::min(s.find(separator, pos), s.size());
+    parts.push_back(s.substr(pos, end - pos));
+    pos = end + 1;
+  }
+  return parts;
+}
+
+template <typename T>
+bool parse(std::string_view s, T& value)
+{
+  const auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc() && ptr == s.data() + s.size();
+}
+
+// Returns the cgroup directories of the process from its own group up to the hierarchy root.
+// Uses the cgroup v1 hierarchy of the controller or the cgroup v2 hierarchy if it is empty.
+std::vector<std::filesystem::path> cgroup(std::string_view controller)
+{
+  std::string group;
+  std::ifstream cgroups("/proc/self/cgroup");
+  for (std::string line; std::getline(cgroups, line);) {
+    // hierarchy-ID:controller-list:cgroup-path
+    const auto parts = split(line, ':');
+    if (parts.size() < 3) {
+      continue;
+    }
+    const auto controllers = split(parts[1], ',');
+    const auto match = controller.empty()
+      ? parts[0] == "0" && parts[1].empty()
+      : std::find(controllers.begin(), controllers.end(), controller) != controllers.end();
+    if (match) {
+      group = line.substr(parts[0].size() + parts[1].size() + 2);
+      break;
+    }
+  }
+  if (group.empty()) {
+    return {};
+  }
+
+  std::ifstream mounts("/proc/self/mountinfo");
+  for (std::string line; std::getline(mounts, line);) {
+    // id parent major:minor root mount-point options [optional...] - type source super-options
+    const auto separator = line.find(" - ");
+    if (separator == std::string::npos) {
+      continue;
+    }
+    const auto fields = split(std::string_view(line).substr(0, separator), ' ');
+    const auto tail = split(std::string_view(line).substr(separator + 3), ' ');
+    if (fields.size() < 5 || tail.size() < 3) {
+      continue;
+    }
+    if (controller.empty() ? tail[0] != "cgroup2" : tail[0] != "cgroup") {
+      continue;
+    }
+    if (!controller.empty()) {
+      const auto options = split(tail[2], ',');
+      if (std::find(options.begin(), options.end(), controller) == options.end()) {
+        continue;
+      }
+    }
+    const std::filesystem::path root(fields[4]);
+    std::string_view relative = group;
+    if (fields[3] != "/" && relative.starts_with(fields[3])) {
+      relative.remove_prefix(fields[3].size());
+    }
+    while (relative.starts_with('/')) {
+      relative.remove_prefix(1);
+    }
+    // With a cgroup namespace or a bind mount of the group, the path may not exist below the
+    // mount point. The mount point is the process group in that case.
+    auto path = root / relative;
+    if (std::error_code ec; !std::filesystem::is_directory(path, ec)) {
+      path = root;
+    }
+    std::vector<std::filesystem::path> directories;
+    for (; path != root && path.has_relative_path(); path = path.parent_path()) {
+      directories.push_back(path);
+    }
+    directories.push_back(root);
+    return directories;
+  }
+  return {};
+}
+
+double cpu_limit()
+{
+  auto limit = 0.0;
+  const auto update = [&](double quota, double period) {
+    if (quota > 0 && period > 0 && (limit == 0.0 || quota / period < limit)) {
+      limit = quota / period;
+    }
+  };
+  if (const auto directories = cgroup({}); !directories.empty()) {
+    for (const auto& directory : directories) {
+      // $MAX $PERIOD
+      const auto line = read_line(directory / "cpu.max");
+      const auto parts = split(line, ' ');
+      double quota = 0;
+      double period = 0;
+      if (parts.size() == 2 && parse(parts[0], quota) && parse(parts[1], period)) {
+        update(quota, period);
+      }
+    }
+    if (limit > 0.0) {
+      return limit;
+    }
+  }
+  for (const auto& directory : cgroup("cpu")) {
+    double quota = 0;
+    double period = 0;
+    if (
+      parse(read_line(directory / "cpu.cfs_quota_us"), quota) &&
+      parse(read_line(directory / "cpu.cfs_period_us"), period)) {
+      update(quota, period);
+    }
+  }
+  return limit;
+}
+
+std::uint64_t memory_limit()
+{
+  // cgroup v1 reports a page aligned LONG_MAX when there is no limit.
+  constexpr std::uint64_t unlimited = std::uint64_t(1) << 62;
+  std::uint64_t limit = 0;
+  const auto update = [&](std::uint64_t value) {
+    if (value > 0 && value < unlimited && (limit == 0 || value < limit)) {
+      limit = value;
+    }
+  };
+  for (const auto& directory : cgroup({})) {
+    if (std::uint64_t value = 0; parse(read_line(directory / "memory.max"), value)) {
+      update(value);
+    }
+  }
+  if (limit) {
+    return limit;
+  }
+  for (const auto& directory : cgroup("memory")) {
+    if (std::uint64_t value = 0; parse(read_line(directory / "memory.limit_in_bytes"), value)) {
+      update(value);
+    }
+  }
+  return limit;
+}
+
+// Parses a list like "0-3,8,10-11".
+std::vector<unsigned> parse_cpu_list(std::string_view s)
+{
+  std::vector<unsigned> cpus;
+  for (const auto range : split(s, ',')) {
+    const auto bounds = split(range, '-');
+    unsigned first = 0;
+    unsigned last = 0;
+    if (!parse(bounds[0], first) || (bounds.size() > 1 && !parse(bounds[1], last))) {
+      continue;
+    }
+    for (auto cpu = first; cpu <= (bounds.size() > 1 ? last : first); cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::vector<unsigned> affinity()
+{
+  std::vector<unsigned> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+// Returns the affinity the process was started with. Linux only reports the affinity of the
+// calling thread, so it is captured before pin() restricts any thread.
+const std::vector<unsigned>& startup_affinity()
+{
+  static const auto cpus = affinity();
+  return cpus;
+}
+
+// Captures the startup affinity during static initialization, before main() can pin threads.
+[[maybe_unused]] const auto& startup_affinity_snapshot = startup_affinity();
+
+std::vector<numa_node> numa_nodes()
+{
+  std::vector<numa_node> nodes;
+  const std::filesystem::path root = "/sys/devices/system/node";
+  for (const auto id : parse_cpu_list(read_line(root / "online"))) {
+    auto cpus = parse_cpu_list(read_line(root / ("node" + std::to_string(id)) / "cpulist"));
+    nodes.push_back({ id, std::move(cpus) });
+  }
+  return nodes;
+}
+
+// Returns the size of the data or unified cache of the processor at the level.
+std::size_t cache_size(unsigned cpu, unsigned level)
+{
+  const auto root =
+    std::filesystem::path("/sys/devices/system/cpu") / ("cpu" + std::to_string(cpu)) / "cache";
+  for (unsigned index = 0;; index++) {
+    const auto directory = root / ("index" + std::to_string(index));
+    const auto type = read_line(directory / "type");
+    if (type.empty()) {
+      return 0;
+    }
+    unsigned value = 0;
+    if (type == "Instruction" || !parse(read_line(directory / "level"), value) || value != level) {
+      continue;
+    }
+    // 48K, 2048K or 32M
+    auto size = read_line(directory / "size");
+    std::size_t scale = 1;
+    if (!size.empty() && (size.back() == 'K' || size.back() == 'M' || size.back() == 'G')) {
+      scale = size.back() == 'K' ? 1 << 10 : size.back() == 'M' ? 1 << 20 : 1 << 30;
+      size.pop_back();
+    }
+    std::size_t bytes = 0;
+    return parse(size, bytes) ? bytes * scale : 0;
+  }
+}
+
+void pin(const std::vector<unsigned>& cpus)
+{
+  startup_affinity();
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const auto cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    const auto ec = std::error_code(errno, std::system_category());
+    throw ice::system_error(ec, "could not set thread affinity");
+  }
+}
+
+#endif
+
+#ifdef _WIN32
+
+std::vector<unsigned> cpus(std::uint64_t mask)
+{
+  std::vector<unsigned> cpus;
+  for (unsigned cpu = 0; cpu < 64; cpu++) {
+    if (mask & (std::uint64_t(1) << cpu)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+void pin(const std::vector<unsigned>& cpus)
+{
+  DWORD_PTR mask = 0;
+  for (const auto cpu : cpus) {
+    if (cpu < sizeof(mask) * 8) {
+      mask |= DWORD_PTR(1) << cpu;
+    }
+  }
+  if (!SetThreadAffinityMask(GetCurrentThread(), mask)) {
+    const auto ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+    throw ice::system_error(ec, "could not set thread affinity");
+  }
+}
+
+#endif
+
+process_info load()
+{
+  process_info info;
+  info.path = executable();
+  info.directory = info.path.parent_path();
+#ifdef _WIN32
+  info.pid = GetCurrentProcessId();
+  char hostname[MAX_COMPUTERNAME_LENGTH + 1];
+  DWORD size = sizeof(hostname);
+  if (GetComputerNameA(hostname, &size)) {
+    info.hostname.assign(hostname, size);
+  }
+  SYSTEM_INFO system = {};
+  GetSystemInfo(&system);
+  info.cpu_count = system.dwNumberOfProcessors;
+  info.page_size = system.dwPageSize;
+#else
+  info.pid = static_cast<std::uint64_t>(getpid());
+  char hostname[256] = {};
+  if (gethostname(hostname, sizeof(hostname) - 1) == 0) {
+    info.hostname = hostname;
+  }
+  if (const auto count = sysconf(_SC_NPROCESSORS_ONLN); count > 0) {
+    info.cpu_count = static_cast<unsigned>(count);
+  }
+  if (const auto size = sysconf(_SC_PAGESIZE); size > 0) {
+    info.page_size = static_cast<std::size_t>(size);
+  }
+#endif
+#ifdef __linux__
+  info.cpu_limit = cpu_limit();
+  info.memory_limit = memory_limit();
+  info.affinity = startup_affinity();
+  info.numa_nodes = numa_nodes();
+  if (!info.affinity.empty()) {
+    info.l2_cache_size = cache_size(info.affinity.front(), 2);
+    info.l3_cache_size = cache_size(info.affinity.front(), 3);
+  }
+#endif
+#ifdef _WIN32
+  DWORD_PTR process = 0;
+  DWORD_PTR system = 0;
+  if (GetProcessAffinityMask(GetCurrentProcess(), &process, &system)) {
+    info.affinity = cpus(process);
+  }
+  ULONG highest = 0;
+  if (GetNumaHighestNodeNumber(&highest)) {
+    for (ULONG node = 0; node <= highest; node++) {
+      ULONGLONG mask = 0;
+      if (GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask) && mask) {
+        info.numa_nodes.push_back({ static_cast<unsigned>(node), cpus(mask) });
+      }
+    }
+  }
+  DWORD length = 0;
+  GetLogicalProcessorInformation(nullptr, &length);
+  std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> processors(
+    length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+  if (GetLogicalProcessorInformation(processors.data(), &length)) {
+    for (const auto& processor : processors) {
+      if (processor.Relationship != RelationCache || processor.Cache.Type == CacheInstruction) {
+        continue;
+      }
+      if (processor.Cache.Level == 2 && !info.l2_cache_size) {
+        info.l2_cache_size = processor.Cache.Size;
+      }
+      if (processor.Cache.Level == 3 && !info.l3_cache_size) {
+        info.l3_cache_size = processor.Cache.Size;
+      }
+    }
+  }
+#endif
+  if (info.affinity.empty()) {
+    for (unsigned cpu = 0; cpu < info.cpu_count; cpu++) {
+      info.affinity.push_back(cpu);
+    }
+  }
+  if (info.numa_nodes.empty()) {
+    info.numa_nodes.push_back({ 0, info.affinity });
+  }
+  info.concurrency = static_cast<unsigned>(info.affinity.size());
+  if (info.cpu_limit > 0.0) {
+    const auto quota = static_cast<unsigned>(std::ceil(info.cpu_limit));
+    info.concurrency = std::min(info.concurrency, std::max(quota, 1u));
+  }
+  return info;
+}
+
+}  // namespace
+
+const process_info& info()
+{
+  static process_info info = []() {
+    auto info = load();
+#ifndef _WIN32
+    // The child of fork() is single-threaded, so nobody reads the pid while it is updated.
+    pthread_atfork(nullptr, nullptr, []() {
+      const_cast<process_info&>(application::info()).pid = static_cast<std::uint64_t>(getpid());
+    });
+#endif
+    return info;
+  }();
+  return info;
+}
+
+void pin_to_cpus(const std::vector<unsigned>& cpus)
+{
+#if defined(__linux__) || defined(_WIN32)
+  pin(cpus);
+#else
+  const auto ec = std::make_error_code(std::errc::not_supported);
+  throw ice::system_error(ec, "could not set thread affinity");
+#endif
+}
+
+void pin_to_cpu(unsigned cpu)
+{
+  pin_to_cpus({ cpu });
+}
+
+void pin_to_node(unsigned node)
+{
+  const auto& nodes = info().numa_nodes;
+  const auto it = std::find_if(nodes.begin(), nodes.end(), [&](const auto& e) {
+    return e.id == node;
+  });
+  if (it == nodes.end()) {
+    const auto ec = std::make_error_code(std::errc::invalid_argument);
+    throw ice::system_error(ec, "could not set thread affinity") << "numa node " << node;
+  }
+  pin_to_cpus(it->cpus);
+}
+
 }  // namespace application
 }  // namespace ice
@@ -1,3 +1,4 @@
+#include <ice/application.hpp>
 #include <ice/exception.hpp>
 #include <ice/log.hpp>
 #include <ice/log/console.hpp>
@@ -6,14 +7,23 @@
 #include <condition_variable>
 #include <mutex>
 #include <set>
+#include <string_view>
 #include <thread>
 #include <tuple>
+#include <cstdint>
 #include <cstdio>
 
 #ifdef _WIN32
 #  include <windows.h>
 #  include <iostream>
 #endif
+#ifdef __linux__
+#  include <sys/resource.h>
+#  include <sys/syscall.h>
+#  include <cerrno>
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
 
 namespace ice {
 namespace log {
@@ -55,34 +65,100 @@ public:
     sinks_.erase(sink);
   }
 
-  void queue(ice::log::time_point time_point, ice::log::severity severity, std::string message)
+  void configure(options options)
   {
     std::lock_guard<std::mutex> lock(messages_mutex_);
-    messages_.push_back({ time_point, severity, std::move(message) });
+    options_ = std::move(options);
+    configured_ = true;
+    if (!options_.lazy) {
+      start();
+    }
+    cv_.notify_one();
+  }
+
+  void queue(message message)
+  {
+    std::lock_guard<std::mutex> lock(messages_mutex_);
+    messages_.push_back(std::move(message));
+    start();
+    cv_.notify_one();
+  }
+
+  static logger& get()
+  {
+    static logger logger;
+    return logger;
+  }
+
+private:
+  // Starts the thread. Requires a lock on messages_mutex_.
+  void start()
+  {
     if (!stop_ && !thread_.joinable()) {
       std::lock_guard<std::mutex> lock(sinks_mutex_);
       if (sinks_.empty()) {
         sinks_.emplace(std::make_shared<console>());
       }
+      configured_ = true;
       thread_ = std::thread([this]() {
         run();
       });
     }
-    cv_.notify_one();
   }
 
-  static logger& get()
+  // Applies the options to the calling thread.
+  static void apply(const options& options)
   {
-    static logger logger;
-    return logger;
+#ifdef __linux__
+    pthread_setname_np(pthread_self(), options.thread_name.substr(0, 15).c_str());
+    if (options.nice) {
+      const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+      if (setpriority(PRIO_PROCESS, tid, *options.nice) != 0) {
+        const auto ec = std::error_code(errno, std::system_category());
+        ice::log::warning() << "could not set logger thread niceness: " << ec;
+      }
+    }
+#endif
+#ifdef _WIN32
+    using set_thread_description = HRESULT(WINAPI*)(HANDLE, PCWSTR);
+    const auto kernel32 = GetModuleHandleW(L"kernel32.dll");
+    if (const auto set = reinterpret_cast<set_thread_description>(
+          reinterpret_cast<void*>(GetProcAddress(kernel32, "SetThreadDescription")))) {
+      const std::wstring name(options.thread_name.begin(), options.thread_name.end());
+      set(GetCurrentThread(), name.c_str());
+    }
+    if (options.nice) {
+      const auto nice = *options.nice;
+      auto priority = THREAD_PRIORITY_NORMAL;
+      if (nice <= -15) {
+        priority = THREAD_PRIORITY_HIGHEST;
+      } else if (nice < 0) {
+        priority = THREAD_PRIORITY_ABOVE_NORMAL;
+      } else if (nice >= 15) {
+        priority = THREAD_PRIORITY_LOWEST;
+      } else if (nice > 0) {
+        priority = THREAD_PRIORITY_BELOW_NORMAL;
+      }
+      if (!SetThreadPriority(GetCurrentThread(), priority)) {
+        const auto ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+        ice::log::warning() << "could not set logger thread priority: " << ec;
+      }
+    }
+#endif
+    if (!options.affinity.empty()) {
+      try {
+        ice::application::pin_to_cpus(options.affinity);
+      }
+      catch (...) {
+        ice::log::warning() << "could not set logger thread affinity: " << std::current_exception();
+      }
+    }
   }
 
-private:
-  void write(const std::vector<message>& messages)
+  // Writes the messages to the sinks and returns the earliest sink deadline. Without messages,
+  // only sinks whose deadline passed are called.
+  std::chrono::steady_clock::time_point write(const std::vector<message>& messages)
   {
-    if (messages.empty()) {
-      return;
-    }
     std::vector<std::weak_ptr<sink>> sinks;
     {
       std::lock_guard<std::mutex> lock(sinks_mutex_);
@@ -90,26 +166,45 @@ private:
         sinks.emplace_back(sink);
       }
     }
+    const auto now = std::chrono::steady_clock::now();
+    auto deadline = std::chrono::steady_clock::time_point::max();
     for (auto& wp : sinks) {
       if (auto sink = wp.lock()) {
-        sink->write(messages);
+        if (!messages.empty() || sink->deadline() <= now) {
+          sink->write(messages);
+        }
+        deadline = std::min(deadline, sink->deadline());
       }
     }
+    return deadline;
   }
 
   void run()
   {
+    auto deadline = std::chrono::steady_clock::time_point::max();
     while (!stop_) {
       std::vector<message> messages;
+      std::optional<options> pending;
       {
         std::unique_lock<std::mutex> lock(messages_mutex_);
-        while (!stop_ && messages_.empty()) {
-          cv_.wait(lock);
+        while (!stop_ && messages_.empty() && !configured_) {
+          if (deadline == std::chrono::steady_clock::time_point::max()) {
+            cv_.wait(lock);
+          } else if (cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+            break;
+          }
+        }
+        if (configured_) {
+          pending = options_;
+          configured_ = false;
         }
         messages = std::move(messages_);
         messages_.clear();
       }
-      write(messages);
+      if (pending) {
+        apply(*pending);
+      }
+      deadline = write(messages);
     }
     std::this_thread::sleep_for(std::chrono::microseconds(10));
     std::lock_guard<std::mutex> lock(messages_mutex_);
@@ -126,9 +221,28 @@ private:
   std::condition_variable cv_;
   std::thread thread_;
 
+  log::options options_;
+  bool configured_ = false;
+
   std::atomic<bool> stop_ = { false };
 };
 
+thread_local std::shared_ptr<const context> current;
+
+std::uint32_t thread_id() noexcept
+{
+  thread_local const auto id = [] {
+#if defined(__linux__)
+    return static_cast<std::uint32_t>(syscall(SYS_gettid));
+#elif defined(_WIN32)
+    return static_cast<std::uint32_t>(GetCurrentThreadId());
+#else
+    return static_cast<std::uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#endif
+  }();
+  return id;
+}
+
 }  // namespace
 
 void add(std::shared_ptr<ice::log::sink> sink)
@@ -141,6 +255,11 @@ void remove(std::shared_ptr<ice::log::sink> sink)
   logger::get().remove(std::move(sink));
 }
 
+void configure(options options)
+{
+  logger::get().configure(std::move(options));
+}
+
 std::string format(time_point tp, bool date, bool milliseconds)
 {
   auto time = clock::to_time_t(tp);
@@ -209,11 +328,75 @@ std::string format(severity s, bool padding)
   return padding ? "unknown  " : "unknown";
 }
 
-stream::stream(severity severity) : std::stringbuf(), std::ostream(this), severity_(severity) {}
+std::string format(const context& context)
+{
+  std::vector<const log::context*> entries;
+  for (auto entry = &context; entry; entry = entry->parent.get()) {
+    entries.push_back(entry);
+  }
+  std::string str;
+  for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+    if (!str.empty()) {
+      str.push_back(' ');
+    }
+    str.append((*it)->key).append(1, '=').append((*it)->value);
+  }
+  return str;
+}
+
+std::string format(const message& message, fields fields)
+{
+  std::string str;
+  char buffer[32];
+  if (ice::bitmask(fields & fields::steady)) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      message.steady_time_point.time_since_epoch());
+    const auto s = std::chrono::duration_cast<std::chrono::seconds>(ns);
+    const auto size = std::snprintf(
+      buffer,
+      sizeof(buffer),
+      "%lld.%09lld",
+      static_cast<long long>(s.count()),
+      static_cast<long long>((ns - s).count()));
+    str.append(buffer, size > 0 ? static_cast<std::size_t>(size) : 0);
+  }
+  if (ice::bitmask(fields & fields::thread)) {
+    if (!str.empty()) {
+      str.push_back(' ');
+    }
+    str.append(std::to_string(message.thread));
+  }
+  if (ice::bitmask(fields & fields::location) && message.location.line()) {
+    if (!str.empty()) {
+      str.push_back(' ');
+    }
+    std::string_view file = message.location.file_name();
+    if (const auto pos = file.find_last_of("/\\"); pos != std::string_view::npos) {
+      file.remove_prefix(pos + 1);
+    }
+    str.append(file).append(1, ':').append(std::to_string(message.location.line()));
+  }
+  return str;
+}
+
+std::shared_ptr<const context> capture() noexcept
+{
+  return current;
+}
+
+void restore(std::shared_ptr<const context> context) noexcept
+{
+  current = std::move(context);
+}
+
+stream::stream(severity severity, std::source_location location)
+  : std::stringbuf(), std::ostream(this), severity_(severity), location_(location)
+{}
 
 stream::stream(stream&& other)
   : std::stringbuf(std::move(other)), std::ostream(this), severity_(other.severity_),
-    time_point_(other.time_point_)
+    time_point_(other.time_point_), steady_time_point_(other.steady_time_point_),
+    context_(std::move(other.context_)), location_(other.location_)
 {}
 
 stream& stream::operator=(stream&& other)
@@ -221,6 +404,9 @@ stream& stream::operator=(stream&& other)
   static_cast<std::stringbuf&>(*this) = std::move(other);
   severity_ = other.severity_;
   time_point_ = other.time_point_;
+  steady_time_point_ = other.steady_time_point_;
+  context_ = std::move(other.context_);
+  location_ = other.location_;
   return *this;
 }
 
@@ -232,7 +418,13 @@ stream::~stream()
     if (pos != std::string::npos) {
       s.erase(pos + 1);
       s.erase(std::remove(s.begin(), s.end(), '\r'), s.end());
-      logger::get().queue(time_point_, severity_, std::move(s));
+      logger::get().queue({ time_point_,
+                            severity_,
+                            std::move(s),
+                            std::move(context_),
+                            steady_time_point_,
+                            location_,
+                            thread_id() });
     }
   }
   catch (...) {
@@ -246,6 +438,19 @@ stream& stream::operator<<(const std::error_code& ec)
   return os;
 }
 
+stream& stream::operator<<(const ice::error& e)
+{
+  auto& os = *this;
+  if (e.code()) {
+    os << e.code().category().name() << ' ' << e.code().value() << ": ";
+  }
+  os << e.what();
+  if (auto info = e.info()) {
+    os << ": " << info;
+  }
+  return os;
+}
+
 stream& stream::operator<<(const std::exception_ptr& e)
 {
   auto& os = *this;
@@ -262,6 +467,9 @@ stream& stream::operator<<(const std::exception_ptr& e)
     if (auto info = e.info()) {
       os << ": " << info;
     }
+    if (auto trace = e.trace()) {
+      os << '\n' << trace->str();
+    }
   }
   catch (const std::exception& e) {
     if (auto se = dynamic_cast<const std::system_error*>(&e)) {
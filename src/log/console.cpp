@@ -9,8 +9,8 @@ namespace log {
 class console::impl
 {
 public:
-  impl(severity severity, bool date, bool milliseconds)
-    : severity_(severity), date_(date), milliseconds_(milliseconds)
+  impl(severity severity, bool date, bool milliseconds, log::fields fields)
+    : severity_(severity), date_(date), milliseconds_(milliseconds), fields_(fields)
   {}
 
   void write(const std::vector<message>& messages)
@@ -36,6 +36,12 @@ public:
       if (message.severity > severity::info) {
         color(os, severity::debug);
       }
+      if (fields_ != log::fields::none) {
+        os << format(message, fields_) << ' ';
+      }
+      if (message.context) {
+        os << '{' << format(*message.context) << "} ";
+      }
       os << message.text;
       color(os);
 #ifdef _WIN32
@@ -83,10 +89,11 @@ private:
   severity severity_ = severity::debug;
   bool date_ = true;
   bool milliseconds_ = true;
+  log::fields fields_ = log::fields::none;
 };
 
-console::console(severity severity, bool date, bool milliseconds)
-  : impl_(std::make_unique<impl>(severity, date, milliseconds))
+console::console(severity severity, bool date, bool milliseconds, log::fields fields)
+  : impl_(std::make_unique<impl>(severity, date, milliseconds, fields))
 {}
 
 console::~console() {}
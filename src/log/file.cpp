@@ -12,8 +12,13 @@ namespace log {
 class file::impl
 {
 public:
-  impl(const std::filesystem::path& filename, severity severity, bool date, bool milliseconds)
-    : severity_(severity), date_(date), milliseconds_(milliseconds)
+  impl(
+    const std::filesystem::path& filename,
+    severity severity,
+    bool date,
+    bool milliseconds,
+    log::fields fields)
+    : severity_(severity), date_(date), milliseconds_(milliseconds), fields_(fields)
   {
     os_.open(filename, std::ios::binary | std::ios::app);
     if (!os_.is_open()) {
@@ -28,7 +33,14 @@ public:
         continue;
       }
       os_ << format(message.time_point, date_, milliseconds_) << " ["
-          << format(message.severity, true) << "] " << message.text;
+          << format(message.severity, true) << "] ";
+      if (fields_ != log::fields::none) {
+        os_ << format(message, fields_) << ' ';
+      }
+      if (message.context) {
+        os_ << '{' << format(*message.context) << "} ";
+      }
+      os_ << message.text;
 #ifdef _WIN32
       os_ << '\r';
 #endif
@@ -42,10 +54,16 @@ private:
   severity severity_ = severity::debug;
   bool date_ = true;
   bool milliseconds_ = true;
+  log::fields fields_ = log::fields::none;
 };
 
-file::file(const std::filesystem::path& filename, severity severity, bool date, bool milliseconds)
-  : impl_(std::make_unique<impl>(filename, severity, date, milliseconds))
+file::file(
+  const std::filesystem::path& filename,
+  severity severity,
+  bool date,
+  bool milliseconds,
+  log::fields fields)
+  : impl_(std::make_unique<impl>(filename, severity, date, milliseconds, fields))
 {}
 
 file::~file() {}
@@ -0,0 +1,789 @@
+#include <ice/exception.hpp>
+#include <ice/log.hpp>
+#include <ice/log/recorder.hpp>
+#include <ice/mapped_file.hpp>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <fcntl.h>
+#  include <io.h>
+#  include <sys/stat.h>
+#else
+#  include <cerrno>
+#  include <csignal>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+// Dump file layout. All integers use the byte order of the writer.
+//
+// The file starts with the magic "ICELOGR1", followed by chunks from oldest to newest:
+//   0  u32      size of the chunk in memory (not used in the file)
+//   4  u32      type: 2 = LZ4 block, 3 = stored
+//   8  u32      data size
+//   12 u32      uncompressed data size
+//   16 u32      FNV-1a checksum of the data
+//   20 u32      reserved
+//   24 data
+//
+// Uncompressed data is a sequence of messages:
+//   0  u32      size of the message
+//   4  u8       severity
+//   5  u8       reserved
+//   6  u16      file name size
+//   8  u32      thread id
+//   12 u32      line
+//   16 u32      context size
+//   20 u32      text size
+//   24 u64      sequence number
+//   32 i64      system clock time in nanoseconds since the epoch
+//   40 i64      steady clock time in nanoseconds
+//   48 file name, context and text
+
+namespace ice {
+namespace log {
+namespace {
+
+constexpr char magic[8] = { 'I', 'C', 'E', 'L', 'O', 'G', 'R', '1' };
+
+// Messages are collected uncompressed until a chunk is full.
+constexpr std::size_t chunk_size = 64 * 1024;
+
+// Minimum time between dumps caused by messages.
+constexpr auto dump_interval = std::chrono::seconds(1);
+
+enum class type : std::uint32_t {
+  padding = 1,
+  compressed = 2,
+  stored = 3,
+};
+
+struct chunk
+{
+  std::uint32_t size;
+  log::type type;
+  std::uint32_t data_size;
+  std::uint32_t raw_size;
+  std::uint32_t checksum;
+  std::uint32_t reserved;
+};
+
+static_assert(sizeof(chunk) == 24);
+
+struct entry
+{
+  std::uint32_t size;
+  std::uint8_t severity;
+  std::uint8_t reserved;
+  std::uint16_t file_size;
+  std::uint32_t thread;
+  std::uint32_t line;
+  std::uint32_t context_size;
+  std::uint32_t text_size;
+  std::uint64_t sequence;
+  std::int64_t time;
+  std::int64_t steady;
+};
+
+static_assert(sizeof(entry) == 48);
+
+constexpr std::size_t align(std::size_t size) noexcept
+{
+  return (size + 7) & ~std::size_t(7);
+}
+
+std::uint32_t checksum(const char* data, std::size_t size) noexcept
+{
+  std::uint32_t hash = 2166136261;
+  for (std::size_t i = 0; i < size; i++) {
+    hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619;
+  }
+  return hash;
+}
+
+// Returns the maximum size of the compressed data.
+constexpr std::size_t compress_bound(std::size_t size) noexcept
+{
+  return size + size / 255 + 16;
+}
+
+std::uint32_t read32(const unsigned char* data) noexcept
+{
+  std::uint32_t value = 0;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+// Compresses the data into an LZ4 block. The destination must hold compress_bound(size) bytes.
+std::size_t compress(const char* source, std::size_t size, char* destination) noexcept
+{
+  constexpr int hash_bits = 12;
+  std::uint32_t table[1 << hash_bits] = {};
+
+  const auto src = reinterpret_cast<const unsigned char*>(source);
+  const auto end = src + size;
+  auto op = reinterpret_cast<unsigned char*>(destination);
+  auto anchor = src;
+
+  const auto write_length = [&op](std::size_t length) {
+    for (length -= 15; length >= 255; length -= 255) {
+      *op++ = 255;
+    }
+    *op++ = static_cast<unsigned char>(length);
+  };
+
+  if (size > 12) {
+    // The last match must start 12 bytes and end 5 bytes before the end of the block.
+    const auto match_limit = end - 12;
+    const auto literal_limit = end - 5;
+    auto ip = src + 1;
+    std::size_t misses = 0;
+    while (ip < match_limit) {
+      const auto value = read32(ip);
+      const auto hash = (value * 2654435761u) >> (32 - hash_bits);
+      auto match = src + table[hash];
+      table[hash] = static_cast<std::uint32_t>(ip - src);
+      if (match >= ip || ip - match > 0xFFFF || read32(match) != value) {
+        // Skip faster through data that does not compress.
+        ip += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+      while (ip > anchor && match > src && ip[-1] == match[-1]) {
+        ip--;
+        match--;
+      }
+      std::size_t length = 4;
+      while (ip + length < literal_limit && ip[length] == match[length]) {
+        length++;
+      }
+
+      const auto literals = static_cast<std::size_t>(ip - anchor);
+      *op++ = static_cast<unsigned char>(
+        (std::min<std::size_t>(literals, 15) << 4) | std::min<std::size_t>(length - 4, 15));
+      if (literals >= 15) {
+        write_length(literals);
+      }
+      std::memcpy(op, anchor, literals);
+      op += literals;
+      const auto offset = static_cast<std::size_t>(ip - match);
+      *op++ = static_cast<unsigned char>(offset & 0xFF);
+      *op++ = static_cast<unsigned char>(offset >> 8);
+      if (length - 4 >= 15) {
+        write_length(length - 4);
+      }
+      ip += length;
+      anchor = ip;
+    }
+  }
+
+  const auto literals = static_cast<std::size_t>(end - anchor);
+  *op++ = static_cast<unsigned char>(std::min<std::size_t>(literals, 15) << 4);
+  if (literals >= 15) {
+    write_length(literals);
+  }
+  std::memcpy(op, anchor, literals);
+  op += literals;
+  return static_cast<std::size_t>(op - reinterpret_cast<unsigned char*>(destination));
+}
+
+// Decompresses an LZ4 block. Returns the decompressed size or std::size_t(-1) if the block is
+// invalid or does not fit into the destination.
+std::size_t decompress(
+  const char* source, std::size_t size, char* destination, std::size_t capacity) noexcept
+{
+  constexpr auto error = std::size_t(-1);
+  auto ip = reinterpret_cast<const unsigned char*>(source);
+  const auto end = ip + size;
+  auto op = reinterpret_cast<unsigned char*>(destination);
+  const auto begin = op;
+  const auto op_end = op + capacity;
+
+  const auto read_length = [&](std::size_t& length) {
+    if (length != 15) {
+      return true;
+    }
+    unsigned char c = 0;
+    do {
+      if (ip == end) {
+        return false;
+      }
+      c = *ip++;
+      length += c;
+    } while (c == 255);
+    return true;
+  };
+
+  while (ip < end) {
+    const auto token = *ip++;
+    std::size_t literals = token >> 4;
+    if (
+      !read_length(literals) || literals > static_cast<std::size_t>(end - ip) ||
+      literals > static_cast<std::size_t>(op_end - op)) {
+      return error;
+    }
+    std::memcpy(op, ip, literals);
+    op += literals;
+    ip += literals;
+    if (ip == end) {
+      break;
+    }
+    if (end - ip < 2) {
+      return error;
+    }
+    const auto offset = static_cast<std::size_t>(ip[0] | ip[1] << 8);
+    ip += 2;
+    std::size_t length = token & 15;
+    if (
+      offset == 0 || offset > static_cast<std::size_t>(op - begin) || !read_length(length) ||
+      length + 4 > static_cast<std::size_t>(op_end - op)) {
+      return error;
+    }
+    length += 4;
+    auto match = op - offset;
+    if (offset >= length) {
+      std::memcpy(op, match, length);
+      op += length;
+    } else {
+      // Overlapping matches repeat the last offset bytes.
+      for (std::size_t i = 0; i < length; i++) {
+        *op++ = *match++;
+      }
+    }
+  }
+  return static_cast<std::size_t>(op - begin);
+}
+
+// File functions that are safe to call from signal handlers.
+
+#ifdef _WIN32
+
+int open_file(const wchar_t* filename) noexcept
+{
+  return _wopen(filename, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+bool write_file(int fd, const void* data, std::size_t size) noexcept
+{
+  auto it = static_cast<const char*>(data);
+  while (size) {
+    const auto chunk = static_cast<unsigned>(std::min<std::size_t>(size, 1 << 30));
+    const auto written = _write(fd, it, chunk);
+    if (written <= 0) {
+      return false;
+    }
+    it += written;
+    size -= static_cast<std::size_t>(written);
+  }
+  return true;
+}
+
+void close_file(int fd) noexcept
+{
+  _close(fd);
+}
+
+bool replace_file(const wchar_t* source, const wchar_t* target) noexcept
+{
+  return MoveFileExW(source, target, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+void remove_file(const wchar_t* filename) noexcept
+{
+  DeleteFileW(filename);
+}
+
+#else
+
+int open_file(const char* filename) noexcept
+{
+  return ::open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+}
+
+bool write_file(int fd, const void* data, std::size_t size) noexcept
+{
+  auto it = static_cast<const char*>(data);
+  while (size) {
+    const auto written = ::write(fd, it, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    it += written;
+    size -= static_cast<std::size_t>(written);
+  }
+  return true;
+}
+
+void close_file(int fd) noexcept
+{
+  ::close(fd);
+}
+
+bool replace_file(const char* source, const char* target) noexcept
+{
+  return ::rename(source, target) == 0;
+}
+
+void remove_file(const char* filename) noexcept
+{
+  ::unlink(filename);
+}
+
+#endif
+
+}  // namespace
+
+class recorder::impl
+{
+public:
+  impl(const std::filesystem::path& filename, std::size_t capacity, severity trigger)
+    : filename_(filename.native()), temp_(filename.native()), crash_(filename.native()),
+      crash_temp_(filename.native()), trigger_(trigger)
+  {
+    temp_ += std::filesystem::path(".tmp").native();
+    crash_ += std::filesystem::path(".crash").native();
+    crash_temp_ += std::filesystem::path(".crash.tmp").native();
+    capacity_ = std::bit_ceil(std::max(capacity, 4 * compress_bound(chunk_size)));
+    storage_ = std::make_unique<char[]>(capacity_);
+    open_ = std::make_unique<char[]>(chunk_size);
+    buffer_ = std::make_unique<char[]>(compress_bound(chunk_size));
+    install();
+  }
+
+  ~impl()
+  {
+    uninstall();
+    // Wait for a signal handler that is still writing a dump and keep later ones out.
+    while (dumping_.test_and_set(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+    if (pending_) {
+      dump(temp_.c_str(), filename_.c_str(), true);
+    }
+  }
+
+  void write(const std::vector<message>& messages)
+  {
+    for (const auto& message : messages) {
+      append(message);
+      if (message.severity <= trigger_) {
+        pending_ = true;
+      }
+    }
+    if (pending_) {
+      const auto now = std::chrono::steady_clock::now();
+      if (now - last_dump_ >= dump_interval) {
+        dump(true);
+        pending_ = false;
+        last_dump_ = now;
+      }
+    }
+  }
+
+  std::chrono::steady_clock::time_point deadline() const noexcept
+  {
+    return pending_ ? last_dump_ + dump_interval : std::chrono::steady_clock::time_point::max();
+  }
+
+  // Writes a dump unless another one is being written. Without compression, the function is
+  // safe to call from a signal handler.
+  void dump(bool compress) noexcept
+  {
+    if (dumping_.test_and_set(std::memory_order_acquire)) {
+      return;
+    }
+    dump(temp_.c_str(), filename_.c_str(), compress);
+    dumping_.clear(std::memory_order_release);
+  }
+
+  // Writes a dump to the crash file. Does not wait for a dump that is being written, so it uses
+  // its own files. Safe to call from a signal handler.
+  void dump_crash() noexcept
+  {
+    dump(crash_temp_.c_str(), crash_.c_str(), false);
+  }
+
+private:
+  using char_type = std::filesystem::path::value_type;
+
+  // Writes the chunks and the messages that are not in a chunk yet to the temporary file and
+  // renames it to the target.
+  void dump(const char_type* temp, const char_type* target, bool compress) noexcept
+  {
+    const auto fd = open_file(temp);
+    if (fd < 0) {
+      return;
+    }
+    auto ok = write_file(fd, magic, sizeof(magic));
+
+    // The writer may overwrite old chunks while a signal handler on another thread reads them.
+    // The loader skips chunks with a wrong checksum.
+    const auto mask = capacity_ - 1;
+    const auto head = head_.load(std::memory_order_acquire);
+    for (auto position = tail_.load(std::memory_order_acquire); ok && position < head;) {
+      const auto offset = static_cast<std::size_t>(position & mask);
+      if (capacity_ - offset < sizeof(chunk)) {
+        position += capacity_ - offset;
+        continue;
+      }
+      log::chunk chunk = {};
+      std::memcpy(&chunk, storage_.get() + offset, sizeof(chunk));
+      if (chunk.size < sizeof(chunk) || chunk.size > capacity_ - offset) {
+        break;
+      }
+      if (chunk.type != type::padding && chunk.data_size <= chunk.size - sizeof(chunk)) {
+        ok = write_file(fd, storage_.get() + offset, sizeof(chunk) + chunk.data_size);
+      }
+      position += chunk.size;
+    }
+
+    const auto size = open_size_.load(std::memory_order_acquire);
+    if (ok && size) {
+      auto chunk = seal(open_.get(), size, compress);
+      const auto data = chunk.type == type::compressed ? buffer_.get() : open_.get();
+      ok = write_file(fd, &chunk, sizeof(chunk)) && write_file(fd, data, chunk.data_size);
+    }
+
+    close_file(fd);
+    if (!ok || !replace_file(temp, target)) {
+      remove_file(temp);
+    }
+  }
+
+  void append(const message& message)
+  {
+    std::string_view file = message.location.file_name();
+    std::string context;
+    if (message.context) {
+      context = format(*message.context);
+    }
+    std::string_view text = message.text;
+
+    const auto budget = chunk_size - sizeof(entry);
+    const auto file_size = std::min({ file.size(), budget / 8, std::size_t(0xFFFF) });
+    const auto context_size = std::min(context.size(), budget / 4);
+    const auto text_size = std::min(text.size(), budget - file_size - context_size);
+    const auto size = sizeof(log::entry) + file_size + context_size + text_size;
+
+    auto offset = open_size_.load(std::memory_order_relaxed);
+    if (chunk_size - offset < size) {
+      store();
+      offset = 0;
+    }
+
+    log::entry entry = {};
+    entry.size = static_cast<std::uint32_t>(size);
+    entry.severity = static_cast<std::uint8_t>(message.severity);
+    entry.file_size = static_cast<std::uint16_t>(file_size);
+    entry.thread = message.thread;
+    entry.line = message.location.line();
+    entry.context_size = static_cast<std::uint32_t>(context_size);
+    entry.text_size = static_cast<std::uint32_t>(text_size);
+    entry.sequence = sequence_++;
+    entry.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      message.time_point.time_since_epoch()).count();
+    entry.steady = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      message.steady_time_point.time_since_epoch()).count();
+
+    auto it = open_.get() + offset;
+    std::memcpy(it, &entry, sizeof(entry));
+    it += sizeof(entry);
+    std::memcpy(it, file.data(), file_size);
+    it += file_size;
+    std::memcpy(it, context.data(), context_size);
+    it += context_size;
+    std::memcpy(it, text.data(), text_size);
+    open_size_.store(offset + size, std::memory_order_release);
+  }
+
+  // Returns the header of a chunk with the data. Compressed data is written to buffer_.
+  log::chunk seal(const char* data, std::size_t size, bool compress) noexcept
+  {
+    log::chunk chunk = {};
+    chunk.type = type::stored;
+    chunk.data_size = static_cast<std::uint32_t>(size);
+    chunk.raw_size = static_cast<std::uint32_t>(size);
+    if (compress) {
+      const auto compressed = log::compress(data, size, buffer_.get());
+      if (compressed < size) {
+        chunk.type = type::compressed;
+        chunk.data_size = static_cast<std::uint32_t>(compressed);
+        data = buffer_.get();
+      }
+    }
+    chunk.size = static_cast<std::uint32_t>(align(sizeof(chunk) + chunk.data_size));
+    chunk.checksum = checksum(data, chunk.data_size);
+    return chunk;
+  }
+
+  // Compresses the open chunk into the storage.
+  void store()
+  {
+    const auto chunk = seal(open_.get(), open_size_.load(std::memory_order_relaxed), true);
+    const auto data = chunk.type == type::compressed ? buffer_.get() : open_.get();
+
+    const auto mask = capacity_ - 1;
+    auto head = head_.load(std::memory_order_relaxed);
+    auto offset = static_cast<std::size_t>(head & mask);
+    if (capacity_ - offset < chunk.size) {
+      const auto padding = capacity_ - offset;
+      reserve(head, padding + chunk.size);
+      if (padding >= sizeof(chunk)) {
+        log::chunk marker = {};
+        marker.size = static_cast<std::uint32_t>(padding);
+        marker.type = type::padding;
+        std::memcpy(storage_.get() + offset, &marker, sizeof(marker));
+      }
+      head += padding;
+      offset = 0;
+    } else {
+      reserve(head, chunk.size);
+    }
+    std::memcpy(storage_.get() + offset, &chunk, sizeof(chunk));
+    std::memcpy(storage_.get() + offset + sizeof(chunk), data, chunk.data_size);
+    // A dump between the two stores misses the chunk instead of writing its messages twice.
+    open_size_.store(0, std::memory_order_release);
+    head_.store(head + chunk.size, std::memory_order_release);
+  }
+
+  // Drops the oldest chunks until there is room for the size after the head.
+  void reserve(std::uint64_t head, std::size_t size)
+  {
+    const auto mask = capacity_ - 1;
+    auto tail = tail_.load(std::memory_order_relaxed);
+    while (head + size - tail > capacity_) {
+      const auto offset = static_cast<std::size_t>(tail & mask);
+      if (capacity_ - offset < sizeof(chunk)) {
+        tail += capacity_ - offset;
+        continue;
+      }
+      std::uint32_t chunk_size = 0;
+      std::memcpy(&chunk_size, storage_.get() + offset, sizeof(chunk_size));
+      tail += chunk_size;
+    }
+    tail_.store(tail, std::memory_order_release);
+  }
+
+  void install() noexcept;
+  void uninstall() noexcept;
+
+#ifndef _WIN32
+  // Dumps when the process receives SIGUSR1.
+  static void handle_request(int signal) noexcept;
+
+  // Dumps and calls the previous handler when the process crashes.
+  static void handle_crash(int signal) noexcept;
+
+  // Recorder that handles signals.
+  inline static std::atomic<impl*> instance_ = nullptr;
+#endif
+
+  std::filesystem::path::string_type filename_;
+  std::filesystem::path::string_type temp_;
+  std::filesystem::path::string_type crash_;
+  std::filesystem::path::string_type crash_temp_;
+  severity trigger_ = severity::error;
+
+  std::size_t capacity_ = 0;
+  std::unique_ptr<char[]> storage_;
+  std::unique_ptr<char[]> open_;
+  std::unique_ptr<char[]> buffer_;
+  std::atomic<std::uint64_t> head_ = 0;
+  std::atomic<std::uint64_t> tail_ = 0;
+  std::atomic<std::size_t> open_size_ = 0;
+  std::uint64_t sequence_ = 0;
+
+  std::atomic_flag dumping_;
+  bool pending_ = false;
+  std::chrono::steady_clock::time_point last_dump_ =
+    std::chrono::steady_clock::now() - dump_interval;
+};
+
+#ifdef _WIN32
+
+void recorder::impl::install() noexcept {}
+
+void recorder::impl::uninstall() noexcept {}
+
+#else
+
+namespace {
+
+constexpr int crash_signals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+
+struct sigaction previous_request = {};
+struct sigaction previous_crash[std::size(crash_signals)] = {};
+
+// Alternate signal stack of the thread that installs the handlers, so that a stack overflow on
+// that thread is dumped as well.
+alignas(16) char alternate_stack[64 * 1024];
+
+}  // namespace
+
+void recorder::impl::handle_request(int) noexcept
+{
+  const auto saved = errno;
+  if (const auto recorder = instance_.load(std::memory_order_acquire)) {
+    recorder->dump(false);
+  }
+  errno = saved;
+}
+
+void recorder::impl::handle_crash(int signal) noexcept
+{
+  if (const auto recorder = instance_.exchange(nullptr, std::memory_order_acq_rel)) {
+    recorder->dump_crash();
+  }
+  // Restore the previous handler and let it handle the signal when this handler returns.
+  for (std::size_t i = 0; i < std::size(crash_signals); i++) {
+    if (crash_signals[i] == signal) {
+      ::sigaction(signal, &previous_crash[i], nullptr);
+    }
+  }
+  ::raise(signal);
+}
+
+void recorder::impl::install() noexcept
+{
+  impl* expected = nullptr;
+  if (!instance_.compare_exchange_strong(expected, this, std::memory_order_acq_rel)) {
+    return;
+  }
+  struct sigaction action = {};
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART | SA_ONSTACK;
+  action.sa_handler = handle_request;
+  ::sigaction(SIGUSR1, &action, &previous_request);
+  action.sa_handler = handle_crash;
+  for (std::size_t i = 0; i < std::size(crash_signals); i++) {
+    ::sigaction(crash_signals[i], &action, &previous_crash[i]);
+  }
+  stack_t stack = {};
+  if (::sigaltstack(nullptr, &stack) == 0 && (stack.ss_flags & SS_DISABLE)) {
+    stack.ss_sp = alternate_stack;
+    stack.ss_size = sizeof(alternate_stack);
+    stack.ss_flags = 0;
+    ::sigaltstack(&stack, nullptr);
+  }
+}
+
+void recorder::impl::uninstall() noexcept
+{
+  auto expected = this;
+  if (!instance_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+    return;
+  }
+  ::sigaction(SIGUSR1, &previous_request, nullptr);
+  for (std::size_t i = 0; i < std::size(crash_signals); i++) {
+    ::sigaction(crash_signals[i], &previous_crash[i], nullptr);
+  }
+  // Only removes the alternate stack when the destructor runs on the installing thread.
+  stack_t stack = {};
+  if (::sigaltstack(nullptr, &stack) == 0 && stack.ss_sp == alternate_stack) {
+    stack = {};
+    stack.ss_flags = SS_DISABLE;
+    ::sigaltstack(&stack, nullptr);
+  }
+}
+
+#endif
+
+recorder::recorder(const std::filesystem::path& filename, std::size_t capacity, severity trigger)
+  : impl_(std::make_unique<impl>(filename, capacity, trigger))
+{}
+
+recorder::~recorder() {}
+
+void recorder::write(const std::vector<message>& messages)
+{
+  impl_->write(messages);
+}
+
+std::chrono::steady_clock::time_point recorder::deadline() const
+{
+  return impl_->deadline();
+}
+
+std::vector<record> recorder::load(const std::filesystem::path& filename)
+{
+  const ice::mapped_file file(filename);
+  const auto data = file.view();
+  if (data.size() < sizeof(magic) || std::memcmp(data.data(), magic, sizeof(magic)) != 0) {
+    throw ice::runtime_error("invalid log dump") << filename.string();
+  }
+
+  std::vector<record> records;
+  const auto buffer = std::make_unique<char[]>(chunk_size);
+  for (auto position = sizeof(magic); data.size() - position >= sizeof(chunk);) {
+    log::chunk chunk = {};
+    std::memcpy(&chunk, data.data() + position, sizeof(chunk));
+    position += sizeof(chunk);
+    if (chunk.data_size > data.size() - position) {
+      break;
+    }
+    const auto chunk_data = data.data() + position;
+    position += chunk.data_size;
+    if (
+      chunk.raw_size > chunk_size || checksum(chunk_data, chunk.data_size) != chunk.checksum) {
+      continue;
+    }
+
+    std::string_view raw;
+    if (chunk.type == type::compressed) {
+      const auto size = decompress(chunk_data, chunk.data_size, buffer.get(), chunk_size);
+      if (size != chunk.raw_size) {
+        continue;
+      }
+      raw = { buffer.get(), size };
+    } else if (chunk.type == type::stored && chunk.data_size == chunk.raw_size) {
+      raw = { chunk_data, chunk.data_size };
+    } else {
+      continue;
+    }
+
+    while (raw.size() >= sizeof(log::entry)) {
+      log::entry entry = {};
+      std::memcpy(&entry, raw.data(), sizeof(entry));
+      const auto payload = std::size_t(entry.file_size) + entry.context_size + entry.text_size;
+      if (
+        entry.size > raw.size() || entry.size != sizeof(entry) + payload ||
+        entry.severity > static_cast<std::uint8_t>(severity::debug)) {
+        break;
+      }
+      auto it = raw.data() + sizeof(entry);
+      auto& record = records.emplace_back();
+      record.sequence = entry.sequence;
+      record.time_point = log::time_point(std::chrono::duration_cast<log::time_point::duration>(
+        std::chrono::nanoseconds(entry.time)));
+      record.steady_time_point =
+        std::chrono::steady_clock::time_point(std::chrono::duration_cast<
+          std::chrono::steady_clock::duration>(std::chrono::nanoseconds(entry.steady)));
+      record.severity = static_cast<log::severity>(entry.severity);
+      record.thread = entry.thread;
+      record.file.assign(it, entry.file_size);
+      it += entry.file_size;
+      record.line = entry.line;
+      record.context.assign(it, entry.context_size);
+      it += entry.context_size;
+      record.text.assign(it, entry.text_size);
+      raw.remove_prefix(entry.size);
+    }
+  }
+  return records;
+}
+
+}  // namespace log
+}  // namespace ice
@@ -0,0 +1,561 @@
+#include <ice/application.hpp>
+#include <ice/exception.hpp>
+#include <ice/log.hpp>
+#include <ice/log/ring.hpp>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <string_view>
+#include <utility>
+#include <cstddef>
+#include <cstring>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace ice {
+namespace log {
+namespace {
+
+constexpr char magic[8] = { 'I', 'C', 'E', 'R', 'I', 'N', 'G', '1' };
+constexpr std::uint32_t version = 1;
+constexpr std::size_t min_capacity = 4096;
+
+struct header
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t header_size;
+  std::uint64_t capacity;
+  std::atomic<std::uint64_t> pid;
+  char reserved0[32];
+  std::atomic<std::uint64_t> head;
+  std::atomic<std::uint64_t> tail;
+  char reserved1[48];
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+static_assert(sizeof(header) == 128);
+static_assert(offsetof(header, head) == 64);
+static_assert(offsetof(header, tail) == 72);
+
+enum class type : std::uint8_t {
+  message = 0,
+  padding = 1,
+};
+
+struct entry
+{
+  std::uint32_t size;
+  log::type type;
+  std::uint8_t severity;
+  std::uint16_t file_size;
+  std::uint64_t sequence;
+  std::int64_t time;
+  std::int64_t steady;
+  std::uint32_t thread;
+  std::uint32_t line;
+  std::uint32_t context_size;
+  std::uint32_t text_size;
+};
+
+static_assert(sizeof(entry) == 48);
+
+constexpr std::size_t align(std::size_t size) noexcept
+{
+  return (size + 7) & ~std::size_t(7);
+}
+
+// Returns true if the record at the offset of the data area is consistent.
+bool valid(const entry& entry, std::size_t offset, std::size_t capacity) noexcept
+{
+  if (entry.size < 8 || entry.size % 8 || entry.size > capacity - offset) {
+    return false;
+  }
+  if (entry.type == type::padding) {
+    return true;
+  }
+  if (entry.type != type::message || entry.size < sizeof(log::entry)) {
+    return false;
+  }
+  const auto payload = std::size_t(entry.file_size) + entry.context_size + entry.text_size;
+  return entry.severity <= static_cast<std::uint8_t>(severity::debug) &&
+    payload <= entry.size - sizeof(log::entry);
+}
+
+// Reads the record at the offset. Padding records at the end of the data area can be shorter
+// than the record structure.
+entry load(const char* data, std::size_t offset, std::size_t capacity) noexcept
+{
+  entry entry = {};
+  std::memcpy(&entry, data + offset, std::min(sizeof(entry), capacity - offset));
+  return entry;
+}
+
+// Shared memory mapping of a whole file.
+class mapping
+{
+public:
+  mapping() noexcept = default;
+
+  mapping(const std::filesystem::path& filename, bool writable, std::size_t size = 0);
+
+  mapping(mapping&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+  {}
+
+  mapping& operator=(mapping&& other) noexcept
+  {
+    mapping m(std::move(other));
+    std::swap(data_, m.data_);
+    std::swap(size_, m.size_);
+    return *this;
+  }
+
+  ~mapping();
+
+  char* data() const noexcept
+  {
+    return data_;
+  }
+
+  std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+private:
+  char* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+#ifdef _WIN32
+
+[[noreturn]] void raise(const char* what, const std::filesystem::path& filename)
+{
+  const auto ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+  throw ice::system_error(ec, what) << filename.string();
+}
+
+// Maps the file. A writable mapping resizes the file to the size if it differs.
+mapping::mapping(const std::filesystem::path& filename, bool writable, std::size_t size)
+{
+  const auto file = CreateFileW(
+    filename.c_str(),
+    writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    nullptr,
+    writable ? OPEN_ALWAYS : OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL,
+    nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    raise("could not open file", filename);
+  }
+  LARGE_INTEGER file_size = {};
+  if (!GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    raise("could not get file size", filename);
+  }
+  if (writable && static_cast<std::size_t>(file_size.QuadPart) != size) {
+    file_size.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(file, file_size, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+      CloseHandle(file);
+      raise("could not resize file", filename);
+    }
+  }
+  if (file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return;
+  }
+  const auto protect = writable ? PAGE_READWRITE : PAGE_READONLY;
+  const auto handle = CreateFileMappingW(file, nullptr, protect, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!handle) {
+    raise("could not map file", filename);
+  }
+  const auto access = writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ;
+  const auto data = MapViewOfFile(handle, access, 0, 0, 0);
+  CloseHandle(handle);
+  if (!data) {
+    raise("could not map file", filename);
+  }
+  data_ = static_cast<char*>(data);
+  size_ = static_cast<std::size_t>(file_size.QuadPart);
+}
+
+mapping::~mapping()
+{
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+}
+
+#else
+
+[[noreturn]] void raise(const char* what, const std::filesystem::path& filename)
+{
+  const auto ec = std::error_code(errno, std::system_category());
+  throw ice::system_error(ec, what) << filename.string();
+}
+
+// Maps the file. A writable mapping replaces the file with a new one if the size differs, so
+// that readers which still map the old file are not affected.
+mapping::mapping(const std::filesystem::path& filename, bool writable, std::size_t size)
+{
+  const auto flags = writable ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC;
+  auto fd = ::open(filename.c_str(), flags, 0644);
+  if (fd < 0) {
+    raise("could not open file", filename);
+  }
+  struct stat st = {};
+  if (::fstat(fd, &st) < 0) {
+    ::close(fd);
+    raise("could not get file size", filename);
+  }
+  if (writable && static_cast<std::size_t>(st.st_size) != size) {
+    ::close(fd);
+    if (::unlink(filename.c_str()) < 0 && errno != ENOENT) {
+      raise("could not remove file", filename);
+    }
+    fd = ::open(filename.c_str(), flags | O_EXCL, 0644);
+    if (fd < 0) {
+      raise("could not create file", filename);
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) < 0) {
+      ::close(fd);
+      raise("could not resize file", filename);
+    }
+    st.st_size = static_cast<off_t>(size);
+  }
+  if (st.st_size == 0) {
+    ::close(fd);
+    return;
+  }
+  const auto file_size = static_cast<std::size_t>(st.st_size);
+  const auto protect = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  const auto data = ::mmap(nullptr, file_size, protect, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    raise("could not map file", filename);
+  }
+  data_ = static_cast<char*>(data);
+  size_ = file_size;
+}
+
+mapping::~mapping()
+{
+  if (data_) {
+    ::munmap(data_, size_);
+  }
+}
+
+#endif
+
+}  // namespace
+
+class ring::impl
+{
+public:
+  impl(const std::filesystem::path& filename, std::size_t capacity, severity severity)
+    : severity_(severity)
+  {
+    capacity = std::bit_ceil(std::max(capacity, min_capacity));
+    mapping_ = mapping(filename, true, sizeof(log::header) + capacity);
+    header_ = reinterpret_cast<log::header*>(mapping_.data());
+    data_ = mapping_.data() + sizeof(log::header);
+    capacity_ = capacity;
+    max_record_size_ = capacity / 4;
+    if (!resume()) {
+      initialize();
+    }
+    header_->pid.store(application::info().pid, std::memory_order_release);
+  }
+
+  ~impl()
+  {
+    header_->pid.store(0, std::memory_order_release);
+  }
+
+  void write(const std::vector<message>& messages)
+  {
+    for (const auto& message : messages) {
+      if (message.severity <= severity_) {
+        append(message);
+      }
+    }
+  }
+
+private:
+  // Continues the existing ring if it is consistent.
+  bool resume()
+  {
+    if (
+      std::memcmp(header_->magic, magic, sizeof(magic)) != 0 || header_->version != version ||
+      header_->header_size != sizeof(log::header) || header_->capacity != capacity_) {
+      return false;
+    }
+    auto head = header_->head.load(std::memory_order_acquire);
+    auto tail = header_->tail.load(std::memory_order_acquire);
+    if (tail > head || head - tail > capacity_ || head % 8 || tail % 8) {
+      return false;
+    }
+    std::uint64_t sequence = 0;
+    for (auto position = tail; position != head;) {
+      const auto offset = static_cast<std::size_t>(position & (capacity_ - 1));
+      const auto entry = load(data_, offset, capacity_);
+      if (!valid(entry, offset, capacity_) || head - position < entry.size) {
+        return false;
+      }
+      if (entry.type == type::message) {
+        sequence = entry.sequence + 1;
+      }
+      position += entry.size;
+    }
+    head_ = head;
+    tail_ = tail;
+    sequence_ = sequence;
+    return true;
+  }
+
+  void initialize()
+  {
+    std::memset(static_cast<void*>(header_), 0, sizeof(log::header));
+    header_->version = version;
+    header_->header_size = sizeof(log::header);
+    header_->capacity = capacity_;
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header_->magic, magic, sizeof(magic));
+  }
+
+  void append(const message& message)
+  {
+    std::string_view file = message.location.file_name();
+    std::string context;
+    if (message.context) {
+      context = format(*message.context);
+    }
+    std::string_view text = message.text;
+
+    // Truncate large messages so that the ring always holds several of them.
+    const auto budget = max_record_size_ - sizeof(log::entry);
+    auto file_size = std::min({ file.size(), budget / 4, std::size_t(0xFFFF) });
+    auto context_size = std::min(context.size(), budget / 4);
+    auto text_size = std::min(text.size(), budget - file_size - context_size);
+    const auto size = align(sizeof(log::entry) + file_size + context_size + text_size);
+
+    auto offset = static_cast<std::size_t>(head_ & (capacity_ - 1));
+    if (capacity_ - offset < size) {
+      const auto padding = capacity_ - offset;
+      reserve(padding + size);
+      log::entry entry = {};
+      entry.size = static_cast<std::uint32_t>(padding);
+      entry.type = type::padding;
+      std::memcpy(data_ + offset, &entry, std::min(sizeof(entry), padding));
+      head_ += padding;
+      offset = 0;
+    } else {
+      reserve(size);
+    }
+
+    log::entry entry = {};
+    entry.size = static_cast<std::uint32_t>(size);
+    entry.type = type::message;
+    entry.severity = static_cast<std::uint8_t>(message.severity);
+    entry.file_size = static_cast<std::uint16_t>(file_size);
+    entry.sequence = sequence_++;
+    entry.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      message.time_point.time_since_epoch()).count();
+    entry.steady = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      message.steady_time_point.time_since_epoch()).count();
+    entry.thread = message.thread;
+    entry.line = message.location.line();
+    entry.context_size = static_cast<std::uint32_t>(context_size);
+    entry.text_size = static_cast<std::uint32_t>(text_size);
+
+    auto it = data_ + offset;
+    std::memcpy(it, &entry, sizeof(entry));
+    it += sizeof(entry);
+    std::memcpy(it, file.data(), file_size);
+    it += file_size;
+    std::memcpy(it, context.data(), context_size);
+    it += context_size;
+    std::memcpy(it, text.data(), text_size);
+
+    head_ += size;
+    header_->head.store(head_, std::memory_order_release);
+  }
+
+  // Moves the tail past the oldest records until there is room for the size after the head.
+  void reserve(std::size_t size)
+  {
+    auto tail = tail_;
+    while (head_ + size - tail > capacity_) {
+      std::uint32_t record_size = 0;
+      std::memcpy(&record_size, data_ + (tail & (capacity_ - 1)), sizeof(record_size));
+      tail += record_size;
+    }
+    if (tail != tail_) {
+      // Readers check the tail after they copied a record.
+      header_->tail.store(tail, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      tail_ = tail;
+    }
+  }
+
+  mapping mapping_;
+  log::header* header_ = nullptr;
+  char* data_ = nullptr;
+  std::size_t capacity_ = 0;
+  std::size_t max_record_size_ = 0;
+  std::uint64_t head_ = 0;
+  std::uint64_t tail_ = 0;
+  std::uint64_t sequence_ = 0;
+  severity severity_ = severity::debug;
+};
+
+ring::ring(const std::filesystem::path& filename, std::size_t capacity, severity severity)
+  : impl_(std::make_unique<impl>(filename, capacity, severity))
+{}
+
+ring::~ring() {}
+
+void ring::write(const std::vector<message>& messages)
+{
+  impl_->write(messages);
+}
+
+class ring_reader::impl
+{
+public:
+  impl(const std::filesystem::path& filename) : mapping_(filename, false)
+  {
+    header_ = reinterpret_cast<const log::header*>(mapping_.data());
+    if (
+      mapping_.size() < sizeof(log::header) ||
+      std::memcmp(header_->magic, magic, sizeof(magic)) != 0 || header_->version != version ||
+      header_->header_size != sizeof(log::header) || !std::has_single_bit(header_->capacity) ||
+      header_->capacity != mapping_.size() - sizeof(log::header)) {
+      throw ice::runtime_error("invalid log ring") << filename.string();
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    data_ = mapping_.data() + sizeof(log::header);
+    capacity_ = static_cast<std::size_t>(header_->capacity);
+    position_ = header_->tail.load(std::memory_order_acquire);
+  }
+
+  bool read(log::record& result)
+  {
+    while (true) {
+      const auto head = header_->head.load(std::memory_order_acquire);
+      if (position_ == head) {
+        return false;
+      }
+      const auto tail = header_->tail.load(std::memory_order_acquire);
+      if (position_ < tail || position_ > head) {
+        position_ = tail;
+        continue;
+      }
+      const auto offset = static_cast<std::size_t>(position_ & (capacity_ - 1));
+      const auto entry = load(data_, offset, capacity_);
+      if (!valid(entry, offset, capacity_)) {
+        if (!overwritten()) {
+          throw ice::runtime_error("invalid log ring record") << position_;
+        }
+        continue;
+      }
+      if (entry.type == type::padding) {
+        if (!overwritten()) {
+          position_ += entry.size;
+        }
+        continue;
+      }
+      auto it = data_ + offset + sizeof(entry);
+      result.file.assign(it, entry.file_size);
+      it += entry.file_size;
+      result.context.assign(it, entry.context_size);
+      it += entry.context_size;
+      result.text.assign(it, entry.text_size);
+      if (overwritten()) {
+        continue;
+      }
+      result.sequence = entry.sequence;
+      result.time_point = log::time_point(std::chrono::duration_cast<log::time_point::duration>(
+        std::chrono::nanoseconds(entry.time)));
+      result.steady_time_point =
+        std::chrono::steady_clock::time_point(std::chrono::duration_cast<
+          std::chrono::steady_clock::duration>(std::chrono::nanoseconds(entry.steady)));
+      result.severity = static_cast<log::severity>(entry.severity);
+      result.thread = entry.thread;
+      result.line = entry.line;
+      if (started_ && entry.sequence > sequence_) {
+        lost_ += entry.sequence - sequence_;
+      }
+      started_ = true;
+      sequence_ = entry.sequence + 1;
+      position_ += entry.size;
+      return true;
+    }
+  }
+
+  std::uint64_t lost() const noexcept
+  {
+    return lost_;
+  }
+
+  std::uint64_t pid() const noexcept
+  {
+    return header_->pid.load(std::memory_order_acquire);
+  }
+
+private:
+  // Returns true if the writer overwrote the record at the current position while it was copied.
+  bool overwritten() const noexcept
+  {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return header_->tail.load(std::memory_order_relaxed) > position_;
+  }
+
+  mapping mapping_;
+  const log::header* header_ = nullptr;
+  const char* data_ = nullptr;
+  std::size_t capacity_ = 0;
+  std::uint64_t position_ = 0;
+  std::uint64_t sequence_ = 0;
+  std::uint64_t lost_ = 0;
+  bool started_ = false;
+};
+
+ring_reader::ring_reader(const std::filesystem::path& filename)
+  : impl_(std::make_unique<impl>(filename))
+{}
+
+ring_reader::ring_reader(ring_reader&& other) noexcept = default;
+
+ring_reader& ring_reader::operator=(ring_reader&& other) noexcept = default;
+
+ring_reader::~ring_reader() {}
+
+bool ring_reader::read(log::record& record)
+{
+  return impl_->read(record);
+}
+
+std::uint64_t ring_reader::lost() const noexcept
+{
+  return impl_->lost();
+}
+
+std::uint64_t ring_reader::pid() const noexcept
+{
+  return impl_->pid();
+}
+
+}  // namespace log
+}  // namespace ice
@@ -0,0 +1,177 @@
+#include <ice/exception.hpp>
+#include <ice/mapped_file.hpp>
+#include <string>
+#include <utility>
+#include <cstring>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace ice {
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::filesystem::path& path)
+{
+  const auto file = CreateFileW(
+    path.c_str(),
+    GENERIC_READ,
+    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+    nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    const auto ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+    throw ice::system_error(ec, "could not open file") << path.string();
+  }
+  LARGE_INTEGER size = {};
+  if (!GetFileSizeEx(file, &size)) {
+    const auto ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+    CloseHandle(file);
+    throw ice::system_error(ec, "could not get file size") << path.string();
+  }
+  if (size.QuadPart == 0) {
+    CloseHandle(file);
+    return;
+  }
+  const auto mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping) {
+    const auto ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+    throw ice::system_error(ec, "could not map file") << path.string();
+  }
+  const auto data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!data) {
+    const auto ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+    throw ice::system_error(ec, "could not map file") << path.string();
+  }
+  data_ = static_cast<char*>(data);
+  size_ = static_cast<std::size_t>(size.QuadPart);
+}
+
+mapped_file::~mapped_file()
+{
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+}
+
+#else
+
+namespace {
+
+// Reads a file that cannot be mapped, such as a /proc file, a pipe or /dev/stdin.
+std::string read(int fd, const std::filesystem::path& path)
+{
+  std::string data;
+  std::size_t size = 0;
+  while (true) {
+    if (data.size() - size < 4096) {
+      data.resize(data.size() * 2 + 4096);
+    }
+    const auto count = ::read(fd, data.data() + size, data.size() - size);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      const auto ec = std::error_code(errno, std::system_category());
+      throw ice::system_error(ec, "could not read file") << path.string();
+    }
+    if (count == 0) {
+      break;
+    }
+    size += static_cast<std::size_t>(count);
+  }
+  data.resize(size);
+  return data;
+}
+
+}  // namespace
+
+mapped_file::mapped_file(const std::filesystem::path& path)
+{
+  const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    const auto ec = std::error_code(errno, std::system_category());
+    throw ice::system_error(ec, "could not open file") << path.string();
+  }
+  struct stat st = {};
+  if (::fstat(fd, &st) < 0) {
+    const auto ec = std::error_code(errno, std::system_category());
+    ::close(fd);
+    throw ice::system_error(ec, "could not get file size") << path.string();
+  }
+  if (st.st_size > 0) {
+    const auto size = static_cast<std::size_t>(st.st_size);
+    const auto data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      ::close(fd);
+#  ifdef MADV_SEQUENTIAL
+      ::madvise(data, size, MADV_SEQUENTIAL);
+#  endif
+      data_ = static_cast<char*>(data);
+      size_ = size;
+      return;
+    }
+    if (errno != ENODEV) {
+      const auto ec = std::error_code(errno, std::system_category());
+      ::close(fd);
+      throw ice::system_error(ec, "could not map file") << path.string();
+    }
+  }
+  // Files in /proc report a size of 0 and files in /sys cannot be mapped although both are
+  // regular files. Read them like pipes into an anonymous mapping, so that the destructor works.
+  std::string contents;
+  try {
+    contents = read(fd, path);
+  }
+  catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  if (contents.empty()) {
+    return;
+  }
+  const auto data =
+    ::mmap(nullptr, contents.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) {
+    const auto ec = std::error_code(errno, std::system_category());
+    throw ice::system_error(ec, "could not map memory") << path.string();
+  }
+  std::memcpy(data, contents.data(), contents.size());
+  data_ = static_cast<char*>(data);
+  size_ = contents.size();
+}
+
+mapped_file::~mapped_file()
+{
+  if (data_) {
+    ::munmap(data_, size_);
+  }
+}
+
+#endif
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+  : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+{}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+  mapped_file file(std::move(other));
+  std::swap(data_, file.data_);
+  std::swap(size_, file.size_);
+  return *this;
+}
+
+}  // namespace ice
@@ -0,0 +1,177 @@
+#include "random.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#  include <sys/random.h>
+#  include <cerrno>
+#endif
+#ifndef _WIN32
+#  include <pthread.h>
+#endif
+
+namespace ice {
+namespace random {
+namespace {
+
+// Number of ChaCha20 blocks generated at once.
+constexpr std::size_t blocks = 4;
+
+// Number of bytes generated before the key is replaced with new entropy.
+constexpr std::size_t reseed_interval = 1024 * 1024;
+
+// Incremented in the child process after fork.
+std::atomic<unsigned> generation = { 0 };
+
+#define ICE_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ICE_QR(a, b, c, d) \
+  a += b;                  \
+  d ^= a;                  \
+  d = ICE_ROTL(d, 16);     \
+  c += d;                  \
+  b ^= c;                  \
+  b = ICE_ROTL(b, 12);     \
+  a += b;                  \
+  d ^= a;                  \
+  d = ICE_ROTL(d, 8);      \
+  c += d;                  \
+  b ^= c;                  \
+  b = ICE_ROTL(b, 7);
+
+// RFC 8439, 2.3
+void chacha20(const std::uint32_t* key, std::uint32_t counter, std::uint8_t* out) noexcept
+{
+  const std::uint32_t input[16] = {
+    0x61707865, 0x3320646e, 0x79622d32, 0x6b206574, key[0], key[1], key[2], key[3],
+    key[4],     key[5],     key[6],     key[7],     counter, 0,     0,      0,
+  };
+  std::uint32_t x[16];
+  std::memcpy(x, input, sizeof(x));
+  for (auto i = 0; i < 10; i++) {
+    ICE_QR(x[0], x[4], x[8], x[12]);
+    ICE_QR(x[1], x[5], x[9], x[13]);
+    ICE_QR(x[2], x[6], x[10], x[14]);
+    ICE_QR(x[3], x[7], x[11], x[15]);
+    ICE_QR(x[0], x[5], x[10], x[15]);
+    ICE_QR(x[1], x[6], x[11], x[12]);
+    ICE_QR(x[2], x[7], x[8], x[13]);
+    ICE_QR(x[3], x[4], x[9], x[14]);
+  }
+  for (auto i = 0; i < 16; i++) {
+    const auto v = x[i] + input[i];
+    out[i * 4 + 0] = static_cast<std::uint8_t>(v);
+    out[i * 4 + 1] = static_cast<std::uint8_t>(v >> 8);
+    out[i * 4 + 2] = static_cast<std::uint8_t>(v >> 16);
+    out[i * 4 + 3] = static_cast<std::uint8_t>(v >> 24);
+  }
+}
+
+#undef ICE_QR
+#undef ICE_ROTL
+
+// Fills the buffer from the operating system. If no entropy source works, the exception of
+// std::random_device leaves this noexcept function and terminates the process: continuing with
+// a zero or stale key would make every generated UUID predictable.
+void entropy(void* data, std::size_t size) noexcept
+{
+  auto pos = static_cast<std::uint8_t*>(data);
+#ifdef __linux__
+  while (size != 0) {
+    const auto rv = getrandom(pos, size, 0);
+    if (rv < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    pos += rv;
+    size -= static_cast<std::size_t>(rv);
+  }
+#endif
+  if (size != 0) {
+    std::random_device rd;
+    while (size != 0) {
+      const auto value = rd();
+      const auto count = std::min(size, sizeof(value));
+      std::memcpy(pos, &value, count);
+      pos += count;
+      size -= count;
+    }
+  }
+}
+
+// Fast key erasure generator: every refill replaces the key with the first 32 bytes of output,
+// so earlier output cannot be reconstructed from the current state.
+class generator
+{
+public:
+  void generate(std::uint8_t* data, std::size_t size) noexcept
+  {
+    const auto current = generation.load(std::memory_order_relaxed);
+    if (current != generation_ || remaining_ == 0) {
+      seed(current);
+    }
+    while (size != 0) {
+      if (remaining_ == 0) {
+        seed(current);
+      } else if (position_ == sizeof(buffer_)) {
+        refill();
+      }
+      const auto count = std::min(size, sizeof(buffer_) - position_);
+      std::memcpy(data, buffer_ + position_, count);
+      std::memset(buffer_ + position_, 0, count);
+      position_ += count;
+      data += count;
+      size -= count;
+      remaining_ -= std::min(remaining_, count);
+    }
+  }
+
+private:
+  void seed(unsigned current) noexcept
+  {
+    entropy(key_, sizeof(key_));
+    generation_ = current;
+    remaining_ = reseed_interval;
+    refill();
+  }
+
+  void refill() noexcept
+  {
+    for (std::uint32_t i = 0; i < blocks; i++) {
+      chacha20(key_, i, buffer_ + i * 64);
+    }
+    std::memcpy(key_, buffer_, sizeof(key_));
+    std::memset(buffer_, 0, sizeof(key_));
+    position_ = sizeof(key_);
+  }
+
+  std::uint32_t key_[8] = {};
+  std::uint8_t buffer_[blocks * 64] = {};
+  std::size_t position_ = sizeof(buffer_);
+  std::size_t remaining_ = 0;
+  unsigned generation_ = 0;
+};
+
+}  // namespace
+
+void generate(void* data, std::size_t size) noexcept
+{
+#ifndef _WIN32
+  static std::once_flag once;
+  std::call_once(once, []() {
+    pthread_atfork(nullptr, nullptr, []() {
+      generation.fetch_add(1, std::memory_order_relaxed);
+    });
+  });
+#endif
+  static thread_local generator generator;
+  generator.generate(static_cast<std::uint8_t*>(data), size);
+}
+
+}  // namespace random
+}  // namespace ice
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+
+namespace ice {
+namespace random {
+
+// Fills the buffer with cryptographically secure random bytes.
+// Uses a per-thread ChaCha20 generator that is seeded from the operating system, reseeded
+// periodically and after fork.
+void generate(void* data, std::size_t size) noexcept;
+
+}  // namespace random
+}  // namespace ice
@@ -0,0 +1,78 @@
+#include <ice/result.hpp>
+
+namespace ice {
+namespace {
+
+// Returns the message that std::system_error was constructed with.
+std::string_view message(const std::system_error& e)
+{
+  std::string_view what = e.what();
+  const auto suffix = ": " + e.code().message();
+  if (what.ends_with(suffix)) {
+    what.remove_suffix(suffix.size());
+  }
+  return what;
+}
+
+}  // namespace
+
+error::error(const std::exception_ptr& e)
+{
+  try {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+  catch (const ice::exception& e) {
+    if (auto se = dynamic_cast<const std::system_error*>(&e)) {
+      code_ = se->code();
+      what_ = message(*se);
+    }
+    else {
+      what_ = e.what();
+    }
+    if (auto info = e.info()) {
+      info_.write(info);
+    }
+  }
+  catch (const std::exception& e) {
+    if (auto se = dynamic_cast<const std::system_error*>(&e)) {
+      code_ = se->code();
+      what_ = message(*se);
+    }
+    else {
+      what_ = e.what();
+    }
+  }
+  catch (...) {
+    what_ = "unhandled exception";
+  }
+}
+
+void error::raise() const
+{
+  if (code_) {
+    auto e = ice::system_error(code_, what_);
+    if (auto info = info_.c_str()) {
+      e << info;
+    }
+    throw e;
+  }
+  auto e = ice::runtime_error(what_);
+  if (auto info = info_.c_str()) {
+    e << info;
+  }
+  throw e;
+}
+
+std::exception_ptr error::exception() const noexcept
+{
+  try {
+    raise();
+  }
+  catch (...) {
+    return std::current_exception();
+  }
+}
+
+}  // namespace ice
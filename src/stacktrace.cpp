@@ -0,0 +1,156 @@
+#include <ice/stacktrace.hpp>
+#include <memory>
+#include <sstream>
+#include <cstdint>
+#include <cstdlib>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <cxxabi.h>
+#  include <dlfcn.h>
+#  ifndef ICE_FRAME_POINTERS
+#    include <unwind.h>
+#  endif
+#endif
+
+namespace ice {
+
+#ifdef _WIN32
+
+stacktrace stacktrace::current(std::size_t skip) noexcept
+{
+  stacktrace trace;
+  const auto frames = static_cast<DWORD>(skip + 1);
+  trace.size_ = CaptureStackBackTrace(frames, capacity, trace.frames_, nullptr);
+  return trace;
+}
+
+std::string stacktrace::str() const
+{
+  std::ostringstream oss;
+  for (std::size_t i = 0; i < size_; i++) {
+    if (i) {
+      oss << '\n';
+    }
+    oss << "#" << i << ' ' << frames_[i];
+    HMODULE module = nullptr;
+    const auto flags =
+      GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT;
+    if (GetModuleHandleExA(flags, static_cast<LPCSTR>(frames_[i]), &module)) {
+      char name[MAX_PATH];
+      if (const auto size = GetModuleFileNameA(module, name, MAX_PATH)) {
+        const auto offset = static_cast<char*>(frames_[i]) - reinterpret_cast<char*>(module);
+        oss << " in " << std::string(name, size) << "+0x" << std::hex << offset << std::dec;
+      }
+    }
+  }
+  return oss.str();
+}
+
+#else
+
+#ifdef ICE_FRAME_POINTERS
+
+// Follows the saved frame pointer chain. Requires everything on the stack to be compiled with
+// -fno-omit-frame-pointer, but is an order of magnitude faster than unwinding.
+__attribute__((noinline)) stacktrace stacktrace::current(std::size_t skip) noexcept
+{
+  stacktrace trace;
+  auto fp = static_cast<void**>(__builtin_frame_address(0));
+  while (fp && trace.size_ < capacity) {
+    if (!fp[1]) {
+      break;
+    }
+    if (skip) {
+      skip--;
+    }
+    else {
+      trace.frames_[trace.size_++] = fp[1];
+    }
+    // The stack grows down, so the caller's frame must be above this one and not too far away.
+    const auto next = static_cast<void**>(fp[0]);
+    if (
+      next <= fp || next - fp > (1 << 20) ||
+      reinterpret_cast<std::uintptr_t>(next) % alignof(void*) != 0) {
+      break;
+    }
+    fp = next;
+  }
+  return trace;
+}
+
+#else
+
+namespace {
+
+struct unwind_state {
+  void** frames;
+  std::size_t size;
+  std::size_t skip;
+};
+
+_Unwind_Reason_Code unwind(_Unwind_Context* context, void* arg) noexcept
+{
+  auto& state = *static_cast<unwind_state*>(arg);
+  const auto ip = _Unwind_GetIP(context);
+  if (!ip) {
+    return _URC_END_OF_STACK;
+  }
+  if (state.skip) {
+    state.skip--;
+    return _URC_NO_REASON;
+  }
+  state.frames[state.size++] = reinterpret_cast<void*>(ip);
+  return state.size < stacktrace::capacity ? _URC_NO_REASON : _URC_END_OF_STACK;
+}
+
+}  // namespace
+
+stacktrace stacktrace::current(std::size_t skip) noexcept
+{
+  stacktrace trace;
+  unwind_state state = { trace.frames_, 0, skip + 1 };
+  _Unwind_Backtrace(unwind, &state);
+  trace.size_ = state.size;
+  return trace;
+}
+
+#endif
+
+std::string stacktrace::str() const
+{
+  std::ostringstream oss;
+  for (std::size_t i = 0; i < size_; i++) {
+    if (i) {
+      oss << '\n';
+    }
+    oss << "#" << i << ' ' << frames_[i];
+
+    // Return addresses point after the call instruction.
+    const auto address = static_cast<char*>(frames_[i]) - 1;
+    Dl_info info = {};
+    if (!dladdr(address, &info)) {
+      continue;
+    }
+    if (info.dli_sname) {
+      int status = 0;
+      std::unique_ptr<char, decltype(&std::free)> name(
+        abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status), &std::free);
+      oss << ' ' << (status == 0 && name ? name.get() : info.dli_sname);
+      oss << "+0x" << std::hex << (address + 1 - static_cast<char*>(info.dli_saddr)) << std::dec;
+    }
+    if (info.dli_fname) {
+      oss << " in " << info.dli_fname;
+      if (!info.dli_sname && info.dli_fbase) {
+        // Offset for addr2line when the symbol is not exported.
+        oss << "+0x" << std::hex << (address + 1 - static_cast<char*>(info.dli_fbase)) << std::dec;
+      }
+    }
+  }
+  return oss.str();
+}
+
+#endif
+
+}  // namespace ice
@@ -1,111 +1,205 @@
+#include "random.hpp"
+#include <ice/base16.hpp>
 #include <ice/exception.hpp>
+#include <ice/simd.hpp>
 #include <ice/uuid.hpp>
 #include <algorithm>
-#include <iomanip>
-#include <limits>
-#include <random>
-#include <cstdio>
+#include <chrono>
+#include <cstring>
 
 // Number of bytes in a formatted UUID string without the terminating character.
 #define UUID_FORMAT_SIZE (8 + 1 + 4 + 1 + 4 + 1 + 4 + 1 + 12)
 
-// Format for sscanf and snprintf.
-#define UUID_FORMAT "%08x-%04hx-%04hx-%02hhx%02hhx-%02hhx%02hhx%02hhx%02hhx%02hhx%02hhx"
+namespace ice {
+namespace {
 
-// Number of elements that have to be parsed/formatted by sscanf and snprintf.
-#define UUID_FORMAT_COUNT 11
+// Positions of the hex digits in a formatted UUID string.
+constexpr std::uint8_t digits[32] = {
+  0,  1,  2,  3,  4,  5,  6,  7,  9,  10, 11, 12, 14, 15, 16, 17,
+  19, 20, 21, 22, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35,
+};
 
-namespace ice {
+#ifdef ICE_SSE2
+
+// Returns true if the 16 characters are hex digits except for dashes at the given positions.
+bool check_block(__m128i chars, int dashes) noexcept
+{
+  const auto lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+  const auto digit = _mm_and_si128(
+    _mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+  const auto alpha = _mm_and_si128(
+    _mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+  const auto dash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('-'));
+  const auto hex = _mm_movemask_epi8(_mm_or_si128(digit, alpha));
+  return _mm_movemask_epi8(dash) == dashes && hex == (~dashes & 0xFFFF);
+}
+
+#endif
+
+}  // namespace
 
 uuid::uuid(std::string_view str)
 {
-  auto count = std::sscanf(
-    str.data(),
-    UUID_FORMAT,
-    &data.v.tl,
-    &data.v.tm,
-    &data.v.thv,
-    &data.v.csr,
-    &data.v.csl,
-    &data.v.n[0],
-    &data.v.n[1],
-    &data.v.n[2],
-    &data.v.n[3],
-    &data.v.n[4],
-    &data.v.n[5]);
-  if (count != UUID_FORMAT_COUNT) {
+  if (!parse(str, *this)) {
     throw ice::runtime_error("uuid format error") << str;
   }
 }
 
+std::array<std::uint8_t, 16> uuid::to_bytes() const noexcept
+{
+  std::array<std::uint8_t, 16> bytes;
+  bytes[0] = static_cast<std::uint8_t>(data.v.tl >> 24);
+  bytes[1] = static_cast<std::uint8_t>(data.v.tl >> 16);
+  bytes[2] = static_cast<std::uint8_t>(data.v.tl >> 8);
+  bytes[3] = static_cast<std::uint8_t>(data.v.tl);
+  bytes[4] = static_cast<std::uint8_t>(data.v.tm >> 8);
+  bytes[5] = static_cast<std::uint8_t>(data.v.tm);
+  bytes[6] = static_cast<std::uint8_t>(data.v.thv >> 8);
+  bytes[7] = static_cast<std::uint8_t>(data.v.thv);
+  bytes[8] = data.v.csr;
+  bytes[9] = data.v.csl;
+  std::memcpy(&bytes[10], data.v.n, 6);
+  return bytes;
+}
+
+uuid uuid::from_bytes(std::span<const std::uint8_t, 16> bytes) noexcept
+{
+  ice::uuid uuid;
+  uuid.data.v.tl = static_cast<std::uint32_t>(bytes[0]) << 24 |
+    static_cast<std::uint32_t>(bytes[1]) << 16 | static_cast<std::uint32_t>(bytes[2]) << 8 |
+    static_cast<std::uint32_t>(bytes[3]);
+  uuid.data.v.tm = static_cast<std::uint16_t>(bytes[4] << 8 | bytes[5]);
+  uuid.data.v.thv = static_cast<std::uint16_t>(bytes[6] << 8 | bytes[7]);
+  uuid.data.v.csr = bytes[8];
+  uuid.data.v.csl = bytes[9];
+  std::memcpy(uuid.data.v.n, &bytes[10], 6);
+  return uuid;
+}
+
 std::string uuid::str() const
 {
   std::string str;
-  str.resize(UUID_FORMAT_SIZE + 1);
-  auto size = std::snprintf(
-    &str[0],
-    UUID_FORMAT_SIZE + 1,
-    UUID_FORMAT,
-    data.v.tl,
-    data.v.tm,
-    data.v.thv,
-    data.v.csr,
-    data.v.csl,
-    data.v.n[0],
-    data.v.n[1],
-    data.v.n[2],
-    data.v.n[3],
-    data.v.n[4],
-    data.v.n[5]);
-  if (size != UUID_FORMAT_SIZE) {
-    throw ice::runtime_error("uuid format size error");
-  }
-  str.resize(static_cast<std::size_t>(size));
+  str.resize(UUID_FORMAT_SIZE);
+  format(reinterpret_cast<char(&)[UUID_FORMAT_SIZE]>(str[0]));
   return str;
 }
 
+void uuid::format(char (&buffer)[36]) const noexcept
+{
+  const auto bytes = to_bytes();
+  char hex[32];
+  base16::encode(std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size()), hex);
+  std::memcpy(buffer, hex, 8);
+  buffer[8] = '-';
+  std::memcpy(buffer + 9, hex + 8, 4);
+  buffer[13] = '-';
+  std::memcpy(buffer + 14, hex + 12, 4);
+  buffer[18] = '-';
+  std::memcpy(buffer + 19, hex + 16, 4);
+  buffer[23] = '-';
+  std::memcpy(buffer + 24, hex + 20, 12);
+}
+
+bool uuid::parse(std::string_view str, uuid& uuid) noexcept
+{
+  if (str.size() != UUID_FORMAT_SIZE) {
+    return false;
+  }
+  const auto src = reinterpret_cast<const std::uint8_t*>(str.data());
+  auto dashes = (src[8] ^ '-') | (src[13] ^ '-') | (src[18] ^ '-') | (src[23] ^ '-');
+  std::uint8_t check = 0;
+  std::uint8_t bytes[16];
+  for (std::size_t i = 0; i < 16; i++) {
+    const auto hi = base16::detail::values[src[digits[i * 2]]];
+    const auto lo = base16::detail::values[src[digits[i * 2 + 1]]];
+    check |= hi | lo;
+    bytes[i] = static_cast<std::uint8_t>(hi << 4 | (lo & 0x0F));
+  }
+  if (dashes != 0 || (check & 0xF0) != 0) {
+    return false;
+  }
+  uuid = from_bytes(bytes);
+  return true;
+}
+
 uuid uuid::generate()
 {
   ice::uuid uuid;
+  generate(std::span<ice::uuid>(&uuid, 1));
+  return uuid;
+}
 
-  // Set the UUID to a random value.
-  static thread_local std::random_device rd;
-  static thread_local std::uniform_int_distribution<uint64_t> dist(
-    0, std::numeric_limits<std::uint64_t>::max());
-  uuid.data.s[0] = dist(rd);
-  uuid.data.s[1] = dist(rd);
+void uuid::generate(std::span<uuid> uuids) noexcept
+{
+  // Set the UUIDs to random values.
+  random::generate(uuids.data(), uuids.size_bytes());
 
   // Set the UUID version according to RFC-4122 (Section 4.2).
-  uuid.data.v.thv = static_cast<decltype(uuid.data.v.thv)>((uuid.data.v.thv & 0x0FFF) | 0x4000);
-  uuid.data.v.csr = static_cast<decltype(uuid.data.v.csr)>((uuid.data.v.csr & 0x3F) | 0x80);
+  for (auto& uuid : uuids) {
+    uuid.data.v.thv = static_cast<decltype(uuid.data.v.thv)>((uuid.data.v.thv & 0x0FFF) | 0x4000);
+    uuid.data.v.csr = static_cast<decltype(uuid.data.v.csr)>((uuid.data.v.csr & 0x3F) | 0x80);
+  }
+}
 
+uuid uuid::generate_v7() noexcept
+{
+  // RFC 9562, Section 6.2, Method 1: the 12 bit rand_a field is a counter that starts at a random
+  // value with the most significant bit cleared and moves the timestamp forward on overflow.
+  static thread_local std::uint64_t last = 0;
+  static thread_local std::uint16_t counter = 0;
+
+  std::uint64_t random[2];
+  random::generate(random, sizeof(random));
+
+  const auto now = std::chrono::system_clock::now().time_since_epoch();
+  const auto ms = static_cast<std::uint64_t>(
+    std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+  if (ms > last) {
+    last = ms;
+    counter = static_cast<std::uint16_t>(random[0] & 0x07FF);
+  } else if (++counter > 0x0FFF) {
+    last++;
+    counter = static_cast<std::uint16_t>(random[0] & 0x07FF);
+  }
+
+  ice::uuid uuid;
+  uuid.data.s[1] = random[1];
+  uuid.data.v.tl = static_cast<std::uint32_t>(last >> 16);
+  uuid.data.v.tm = static_cast<std::uint16_t>(last);
+  uuid.data.v.thv = static_cast<std::uint16_t>(0x7000 | counter);
+  uuid.data.v.csr = static_cast<decltype(uuid.data.v.csr)>((uuid.data.v.csr & 0x3F) | 0x80);
   return uuid;
 }
 
 bool uuid::check(std::string_view str) noexcept
 {
-  if (str.size() != 36) {
+  if (str.size() != UUID_FORMAT_SIZE) {
     return false;
   }
-  for (std::size_t i = 0, size = str.size(); i < size; i++) {
-    auto c = str[i];
-    switch (i) {
-    case 8:
-    case 13:
-    case 18:
-    case 23:
-      if (c != '-') {
-        return false;
-      }
-      break;
-    default:
-      if ((c < '0' || c > '9') && (c < 'a' || c > 'f')) {
-        return false;
-      }
-      break;
-    }
+  const auto src = reinterpret_cast<const std::uint8_t*>(str.data());
+#ifdef ICE_SSE2
+  // Dash positions in the loads at offsets 0, 16 and 20.
+  const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+  const auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 20));
+  return check_block(a, 0x2100) && check_block(b, 0x0084) && check_block(c, 0x0008);
+#else
+  auto dashes = (src[8] ^ '-') | (src[13] ^ '-') | (src[18] ^ '-') | (src[23] ^ '-');
+  std::uint8_t check = 0;
+  for (const auto i : digits) {
+    check |= base16::detail::values[src[i]];
   }
-  return true;
+  return dashes == 0 && (check & 0xF0) == 0;
+#endif
+}
+
+bool uuid::check_all(std::span<const std::string_view> strs) noexcept
+{
+  auto result = true;
+  for (const auto str : strs) {
+    result &= check(str);
+  }
+  return result;
 }
 
 }  // namespace ice
@@ -0,0 +1,98 @@
+#include <ice/simd.hpp>
+#include <ice/uuid_vector.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace ice {
+namespace {
+
+bool equal(const uuid_vector::value_type& a, const uuid_vector::value_type& b) noexcept
+{
+#ifdef ICE_SSE2
+  const auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.data()));
+  const auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.data()));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xFFFF;
+#else
+  return std::memcmp(a.data(), b.data(), a.size()) == 0;
+#endif
+}
+
+}  // namespace
+
+uuid_vector::uuid_vector(std::span<const uuid> uuids)
+{
+  values_.resize(uuids.size());
+  for (size_type i = 0; i < uuids.size(); i++) {
+    values_[i] = uuids[i].to_bytes();
+  }
+}
+
+void uuid_vector::sort()
+{
+  const auto size = values_.size();
+  if (size < 2) {
+    return;
+  }
+
+  // Count all digits in one pass.
+  std::vector<std::array<size_type, 256>> counts(16);
+  for (const auto& value : values_) {
+    for (std::size_t i = 0; i < 16; i++) {
+      counts[i][value[i]]++;
+    }
+  }
+
+  std::vector<value_type> buffer(size);
+  auto src = &values_;
+  auto dst = &buffer;
+  for (std::size_t i = 16; i-- > 0;) {
+    auto& count = counts[i];
+    if (std::find(count.begin(), count.end(), size) != count.end()) {
+      continue;
+    }
+    size_type offset = 0;
+    for (auto& entry : count) {
+      const auto n = entry;
+      entry = offset;
+      offset += n;
+    }
+    for (const auto& value : *src) {
+      (*dst)[count[value[i]]++] = value;
+    }
+    std::swap(src, dst);
+  }
+  if (src != &values_) {
+    values_.swap(buffer);
+  }
+}
+
+void uuid_vector::unique() noexcept
+{
+  values_.erase(std::unique(values_.begin(), values_.end(), equal), values_.end());
+}
+
+uuid_vector::size_type uuid_vector::find(const uuid& uuid) const noexcept
+{
+  const auto bytes = uuid.to_bytes();
+  for (size_type i = 0, size = values_.size(); i < size; i++) {
+    if (equal(values_[i], bytes)) {
+      return i;
+    }
+  }
+  return npos;
+}
+
+uuid_vector::size_type uuid_vector::lower_bound(const uuid& uuid) const noexcept
+{
+  const auto bytes = uuid.to_bytes();
+  const auto it = std::lower_bound(values_.begin(), values_.end(), bytes);
+  return static_cast<size_type>(it - values_.begin());
+}
+
+bool uuid_vector::contains_sorted(const uuid& uuid) const noexcept
+{
+  const auto index = lower_bound(uuid);
+  return index < values_.size() && values_[index] == uuid.to_bytes();
+}
+
+}  // namespace ice